@@ -0,0 +1,183 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/binary.hpp>
+#include <aulos_core/composition.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/data.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	template <typename Function>
+	double medianMilliseconds(size_t iterations, Function&& function)
+	{
+		std::vector<double> times;
+		times.reserve(iterations);
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const auto start = Clock::now();
+			function();
+			times.emplace_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+
+	// Appends copies of all fragments after the end of the composition to make it larger.
+	void repeatComposition(seir::synth::CompositionData& composition, size_t repeat)
+	{
+		size_t length = 0;
+		for (const auto& part : composition._parts)
+			for (const auto& track : part->_tracks)
+				if (!track->_fragments.empty())
+				{
+					const auto& [offset, sequence] = *track->_fragments.rbegin();
+					size_t sequenceLength = 0;
+					for (const auto& sound : sequence->_sounds)
+						sequenceLength += sound._delay;
+					length = std::max(length, offset + sequenceLength + 1);
+				}
+		for (const auto& part : composition._parts)
+			for (const auto& track : part->_tracks)
+			{
+				const auto fragments = track->_fragments;
+				for (size_t i = 1; i < repeat; ++i)
+					for (const auto& [offset, sequence] : fragments)
+						track->_fragments.emplace(offset + i * length, sequence);
+			}
+	}
+
+	std::string toText(const seir::synth::Composition& composition)
+	{
+		const auto buffer = seir::synth::serialize(composition);
+		return { reinterpret_cast<const char*>(buffer.data()), buffer.size() };
+	}
+
+	std::string toText(const seir::synth::CompositionData& composition)
+	{
+		return ::toText(*composition.pack());
+	}
+
+	// Checks that the original file survives conversion to the binary format and back. The result is "identical"
+	// if the text serialized from the binary data matches the original file byte for byte, and "lossless" if it
+	// differs only in formatting, i. e. matches the text serialized directly from the parsed original.
+	std::string_view roundTrip(const std::string& source, const seir::synth::Composition& parsed)
+	{
+		aulos::MemorySink binary;
+		std::string error;
+		if (!aulos::saveBinaryComposition(seir::synth::CompositionData{ parsed }, binary))
+			return "MISMATCH";
+		const auto loaded = aulos::loadBinaryComposition(binary.data(), error);
+		if (!loaded)
+			return "MISMATCH";
+		const auto text = ::toText(*loaded);
+		if (text == source)
+			return "identical";
+		return text == ::toText(parsed) ? "lossless" : "MISMATCH";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t iterations = 20;
+	size_t repeat = 1;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg{ argv[i] };
+		if ((arg == "-i" || arg == "--iterations") && i + 1 < argc)
+			iterations = std::max<size_t>(std::stoul(argv[++i]), 1);
+		else if ((arg == "-r" || arg == "--repeat") && i + 1 < argc)
+			repeat = std::max<size_t>(std::stoul(argv[++i]), 1);
+		else if (arg == "-h" || arg == "--help")
+		{
+			std::cout << "Usage: aulos_format_benchmark [-i ITERATIONS] [-r REPEAT] FILE...\n"
+						 "Compare text and binary composition loading times.\n"
+						 "Compositions are made REPEAT times longer to simulate large files.\n"
+						 "The round trip is checked on the original compositions, and the result is \"identical\" if the text\n"
+						 "converted from binary matches the original file, or \"lossless\" if it differs only in formatting.\n";
+			return 0;
+		}
+		else
+			inputs.emplace_back(std::filesystem::path{ arg });
+	}
+
+	std::cout << std::left << std::setw(32) << "file" << std::right
+			  << std::setw(12) << "text bytes" << std::setw(12) << "bin bytes"
+			  << std::setw(12) << "text ms" << std::setw(12) << "bin ms" << std::setw(12) << "file ms"
+			  << std::setw(10) << "speedup" << "  round trip\n";
+	bool failed = false;
+	for (const auto& input : inputs)
+	{
+		seir::synth::CompositionData composition;
+		std::string_view roundTrip;
+		try
+		{
+			std::ifstream stream{ input, std::ios::binary };
+			if (!stream)
+				throw std::runtime_error{ "Unable to open file" };
+			const std::string source{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+			const auto parsed = seir::synth::Composition::create(source.c_str());
+			if (!parsed)
+				throw std::runtime_error{ "Invalid composition" };
+			composition = seir::synth::CompositionData{ *parsed };
+			roundTrip = ::roundTrip(source, *parsed);
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << input.string() << ": " << e.what() << "\n";
+			failed = true;
+			continue;
+		}
+		::repeatComposition(composition, repeat);
+
+		const auto text = ::toText(composition);
+		aulos::MemorySink binary;
+		aulos::saveBinaryComposition(composition, binary);
+		const auto binaryPath = std::filesystem::temp_directory_path() / (input.stem().string() + ".benchmark.aulosb");
+		{
+			aulos::FileSink sink{ binaryPath };
+			sink.write(binary.data().data(), binary.data().size());
+			sink.commit();
+		}
+
+		// Loading text includes the copy into the editable representation, since that's what the Studio needs.
+		const auto textTime = ::medianMilliseconds(iterations, [&text] {
+			const seir::synth::CompositionData data{ *seir::synth::Composition::create(text.c_str()) };
+		});
+		std::string error;
+		const auto binaryTime = ::medianMilliseconds(iterations, [&binary, &error] {
+			aulos::loadBinaryComposition(binary.data(), error);
+		});
+		const auto fileTime = ::medianMilliseconds(iterations, [&binaryPath, &error] {
+			aulos::loadCompositionData(binaryPath, error);
+		});
+		std::filesystem::remove(binaryPath);
+
+		failed = failed || roundTrip == "MISMATCH";
+
+		std::cout << std::left << std::setw(32) << input.filename().string() << std::right << std::fixed << std::setprecision(3)
+				  << std::setw(12) << text.size() << std::setw(12) << binary.data().size()
+				  << std::setw(12) << textTime << std::setw(12) << binaryTime << std::setw(12) << fileTime
+				  << std::setw(9) << std::setprecision(1) << textTime / binaryTime << 'x'
+				  << "  " << roundTrip << "\n";
+	}
+	return failed ? 1 : 0;
+}
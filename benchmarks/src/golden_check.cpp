@@ -0,0 +1,358 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/composition.hpp>
+#include <aulos_core/hash.hpp>
+#include <aulos_core/render.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/data.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Golden renders use the default export format.
+	constexpr unsigned kSamplingRate = 48'000;
+	constexpr auto kChannelLayout = seir::synth::ChannelLayout::Stereo;
+	constexpr size_t kChannels = 2;
+	constexpr size_t kBlockFrames = 4'096;
+	constexpr std::string_view kSignature = "aulos-golden 1";
+
+	struct Block
+	{
+		uint64_t _hash = 0;
+		float _peak = 0;
+		float _rms = 0;
+	};
+
+	// Compact description of a rendered waveform.
+	struct Fingerprint
+	{
+		size_t _frames = 0;
+		std::vector<Block> _blocks;
+	};
+
+	struct Golden
+	{
+		Fingerprint _mix;
+		std::vector<Fingerprint> _tracks; // In part order, then in track order.
+	};
+
+	double elapsedMilliseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	Fingerprint makeFingerprint(const std::vector<std::byte>& data)
+	{
+		const auto samples = reinterpret_cast<const float*>(data.data());
+		Fingerprint result;
+		result._frames = data.size() / (sizeof(float) * kChannels);
+		for (size_t first = 0; first < result._frames; first += kBlockFrames)
+		{
+			const auto sampleCount = std::min(kBlockFrames, result._frames - first) * kChannels;
+			auto& block = result._blocks.emplace_back();
+			aulos::Hash hash;
+			double sum = 0;
+			for (auto i = samples + first * kChannels, end = i + sampleCount; i != end; ++i)
+			{
+				// Samples are quantized to 16 bits so that the hash ignores insignificant rounding differences.
+				hash.add(static_cast<int16_t>(std::lround(std::clamp(*i, -1.f, 1.f) * 32'767.f)));
+				block._peak = std::max(block._peak, std::abs(*i));
+				sum += double{ *i } * *i;
+			}
+			block._hash = hash.value();
+			block._rms = static_cast<float>(std::sqrt(sum / sampleCount));
+		}
+		return result;
+	}
+
+	// Renders the composition the same way as the Studio exports it, except that the output is raw.
+	std::optional<Fingerprint> renderFingerprint(const seir::synth::Composition& composition, float amplitude)
+	{
+		const auto normalized = aulos::normalizeComposition(composition, amplitude);
+		if (!normalized)
+			return {};
+		aulos::MemorySink sink;
+		aulos::RenderOptions options;
+		options._outputFormat = aulos::OutputFormat::Raw;
+		if (aulos::render(*normalized, { kSamplingRate, kChannelLayout }, sink, options) != aulos::RenderStatus::Completed)
+			return {};
+		return ::makeFingerprint(sink.data());
+	}
+
+	// Packs a copy of the composition which contains only the specified track.
+	std::unique_ptr<seir::synth::Composition> packTrack(const seir::synth::CompositionData& data, size_t partIndex, size_t trackIndex)
+	{
+		const auto copy = aulos::copyCompositionData(data);
+		copy->_gainDivisor = 1.f;
+		for (size_t i = 0; i < copy->_parts.size(); ++i)
+		{
+			auto& tracks = copy->_parts[i]->_tracks;
+			if (i != partIndex)
+				tracks.clear();
+			else
+				tracks = { tracks[trackIndex] };
+		}
+		return copy->pack();
+	}
+
+	void writeFingerprint(std::ostream& stream, const Fingerprint& fingerprint)
+	{
+		stream << fingerprint._frames << ' ' << fingerprint._blocks.size() << '\n';
+		for (const auto& block : fingerprint._blocks)
+			stream << std::hex << std::setw(16) << std::setfill('0') << block._hash << std::dec << std::setfill(' ') << ' ' << block._peak << ' ' << block._rms << '\n';
+	}
+
+	bool readFingerprint(std::istream& stream, Fingerprint& fingerprint)
+	{
+		size_t blockCount = 0;
+		if (!(stream >> fingerprint._frames >> blockCount))
+			return false;
+		fingerprint._blocks.resize(blockCount);
+		for (auto& block : fingerprint._blocks)
+			if (!(stream >> std::hex >> block._hash >> std::dec >> block._peak >> block._rms))
+				return false;
+		return true;
+	}
+
+	bool saveGolden(const std::filesystem::path& path, const Golden& golden)
+	{
+		std::ofstream stream{ path, std::ios::trunc };
+		stream << std::setprecision(9) << kSignature << '\n'
+			   << kSamplingRate << ' ' << kChannels << ' ' << kBlockFrames << ' ' << golden._tracks.size() << '\n';
+		::writeFingerprint(stream, golden._mix);
+		for (const auto& track : golden._tracks)
+			::writeFingerprint(stream, track);
+		return static_cast<bool>(stream.flush());
+	}
+
+	std::optional<Golden> loadGolden(const std::filesystem::path& path)
+	{
+		std::ifstream stream{ path };
+		std::string signature;
+		if (!std::getline(stream, signature) || signature != kSignature)
+			return {};
+		unsigned samplingRate = 0;
+		size_t channels = 0;
+		size_t blockFrames = 0;
+		size_t trackCount = 0;
+		if (!(stream >> samplingRate >> channels >> blockFrames >> trackCount) || samplingRate != kSamplingRate || channels != kChannels || blockFrames != kBlockFrames)
+			return {};
+		Golden golden;
+		if (!::readFingerprint(stream, golden._mix))
+			return {};
+		golden._tracks.resize(trackCount);
+		for (auto& track : golden._tracks)
+			if (!::readFingerprint(stream, track))
+				return {};
+		return golden;
+	}
+
+	// Returns the index of the first block which differs beyond the tolerance.
+	std::optional<size_t> findDivergence(const Fingerprint& expected, const Fingerprint& actual, float tolerance, bool& inexact)
+	{
+		inexact = false;
+		const auto blockCount = std::min(expected._blocks.size(), actual._blocks.size());
+		for (size_t i = 0; i < blockCount; ++i)
+		{
+			const auto& expectedBlock = expected._blocks[i];
+			const auto& actualBlock = actual._blocks[i];
+			if (expectedBlock._hash == actualBlock._hash)
+				continue;
+			if (std::abs(expectedBlock._peak - actualBlock._peak) > tolerance || std::abs(expectedBlock._rms - actualBlock._rms) > tolerance)
+				return i;
+			inexact = true;
+		}
+		if (expected._frames != actual._frames)
+			return std::min(expected._frames, actual._frames) / kBlockFrames;
+		return {};
+	}
+
+	enum class Result
+	{
+		Passed,
+		Updated,
+		Failed,
+	};
+
+	Result checkFile(const std::filesystem::path& input, const std::filesystem::path& goldenDirectory, bool update, float tolerance)
+	{
+		const auto name = input.filename().string();
+		std::string error;
+		const auto loadStart = Clock::now();
+		const auto data = aulos::loadCompositionData(input, error);
+		if (!data)
+		{
+			std::cerr << name << ": " << error << "\n";
+			return Result::Failed;
+		}
+		const auto loadTime = ::elapsedMilliseconds(loadStart);
+
+		const auto packStart = Clock::now();
+		data->_gainDivisor = 1.f;
+		const auto composition = data->pack();
+		const auto amplitude = composition ? aulos::measureAmplitude(*composition) : std::nullopt;
+		if (!amplitude)
+		{
+			std::cerr << name << ": Unable to pack composition\n";
+			return Result::Failed;
+		}
+		const auto packTime = ::elapsedMilliseconds(packStart);
+
+		const auto renderStart = Clock::now();
+		Golden actual;
+		if (auto mix = ::renderFingerprint(*composition, *amplitude))
+			actual._mix = std::move(*mix);
+		else
+		{
+			std::cerr << name << ": Unable to render composition\n";
+			return Result::Failed;
+		}
+		const auto renderTime = ::elapsedMilliseconds(renderStart);
+
+		const auto timings = [&] {
+			std::cout << std::fixed << std::setprecision(1) << " (load " << loadTime << " ms, gain " << packTime << " ms, render " << renderTime << " ms)\n"
+					  << std::defaultfloat;
+		};
+
+		const auto goldenPath = goldenDirectory / input.filename().replace_extension(".golden");
+		const auto expected = update ? std::nullopt : ::loadGolden(goldenPath);
+		if (!update && !expected)
+		{
+			std::cerr << name << ": Missing or invalid golden file " << goldenPath.string() << " (use --update to create it)\n";
+			return Result::Failed;
+		}
+
+		// Tracks are rendered separately only when they're needed, since it takes as long as rendering the mix.
+		bool inexact = false;
+		const auto divergence = expected ? ::findDivergence(expected->_mix, actual._mix, tolerance, inexact) : std::nullopt;
+		if (update || divergence)
+		{
+			for (size_t i = 0; i < data->_parts.size(); ++i)
+				for (size_t j = 0; j < data->_parts[i]->_tracks.size(); ++j)
+				{
+					const auto track = ::packTrack(*data, i, j);
+					auto fingerprint = track ? ::renderFingerprint(*track, *amplitude) : std::nullopt;
+					if (!fingerprint)
+					{
+						std::cerr << name << ": Unable to render part " << i + 1 << " track " << j + 1 << "\n";
+						return Result::Failed;
+					}
+					actual._tracks.emplace_back(std::move(*fingerprint));
+				}
+		}
+
+		if (update)
+		{
+			if (!::saveGolden(goldenPath, actual))
+			{
+				std::cerr << name << ": Unable to write " << goldenPath.string() << "\n";
+				return Result::Failed;
+			}
+			std::cout << name << ": UPDATED";
+			timings();
+			return Result::Updated;
+		}
+
+		if (!divergence)
+		{
+			std::cout << name << (inexact ? ": PASSED (within tolerance)" : ": PASSED");
+			timings();
+			return Result::Passed;
+		}
+
+		std::cout << name << ": FAILED at frame " << *divergence * kBlockFrames;
+		if (expected->_tracks.size() == actual._tracks.size())
+		{
+			std::optional<size_t> firstBlock;
+			size_t trackIndex = 0;
+			for (size_t i = 0; i < actual._tracks.size(); ++i)
+				if (const auto block = ::findDivergence(expected->_tracks[i], actual._tracks[i], tolerance, inexact); block && (!firstBlock || *block < *firstBlock))
+				{
+					firstBlock = block;
+					trackIndex = i;
+				}
+			if (firstBlock)
+			{
+				for (const auto& part : data->_parts)
+				{
+					if (trackIndex < part->_tracks.size())
+					{
+						std::cout << ", first diverging track is " << trackIndex + 1 << " of voice \"" << part->_voiceName << "\" at frame " << *firstBlock * kBlockFrames;
+						break;
+					}
+					trackIndex -= part->_tracks.size();
+				}
+			}
+		}
+		else
+			std::cout << ", track count changed from " << expected->_tracks.size() << " to " << actual._tracks.size();
+		timings();
+		return Result::Failed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool update = false;
+	float tolerance = 1e-3f;
+	std::filesystem::path goldenDirectory{ AULOS_GOLDEN_DIR };
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg{ argv[i] };
+		if ((arg == "-d" || arg == "--golden-dir") && i + 1 < argc)
+			goldenDirectory = argv[++i];
+		else if ((arg == "-t" || arg == "--tolerance") && i + 1 < argc)
+			tolerance = std::stof(argv[++i]);
+		else if (arg == "-u" || arg == "--update")
+			update = true;
+		else if (arg == "-h" || arg == "--help")
+		{
+			std::cout << "Usage: aulos_golden_check [-d DIR] [-t TOLERANCE] [-u] [FILE...]\n"
+						 "Check that compositions render the same as when their golden fingerprints were recorded.\n"
+						 "Checks the bundled examples if no files are specified.\n"
+						 "\n"
+						 "  -d, --golden-dir DIR     Directory with golden fingerprints\n"
+						 "  -t, --tolerance VALUE    Maximum allowed block peak or RMS difference (default: 0.001)\n"
+						 "  -u, --update             Record new golden fingerprints instead of checking\n";
+			return 0;
+		}
+		else
+			inputs.emplace_back(std::filesystem::path{ arg });
+	}
+	if (inputs.empty())
+	{
+		for (const auto& entry : std::filesystem::directory_iterator{ AULOS_EXAMPLES_DIR })
+			if (entry.path().extension() == ".aulos")
+				inputs.emplace_back(entry.path());
+		std::sort(inputs.begin(), inputs.end());
+	}
+
+	if (update)
+		std::filesystem::create_directories(goldenDirectory);
+	size_t failures = 0;
+	for (const auto& input : inputs)
+		if (::checkFile(input, goldenDirectory, update, tolerance) == Result::Failed)
+			++failures;
+	if (failures)
+		std::cout << failures << " of " << inputs.size() << " compositions failed\n";
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/composition.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// The same rates the Studio offers for playback and export.
+	constexpr unsigned kSamplingRates[]{ 48'000, 44'100, 32'000, 24'000, 22'050, 16'000, 11'025, 8'000 };
+
+	constexpr size_t kBufferFrames = 65'536;
+
+	struct Statistics
+	{
+		double _mean = 0;   // Milliseconds.
+		double _stddev = 0; // Milliseconds.
+		double _min = 0;    // Milliseconds.
+	};
+
+	template <typename Function>
+	Statistics measure(size_t iterations, Function&& function)
+	{
+		std::vector<double> times;
+		times.reserve(iterations);
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const auto start = Clock::now();
+			function();
+			times.emplace_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		Statistics result;
+		result._mean = std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+		if (times.size() > 1)
+			result._stddev = std::sqrt(std::accumulate(times.cbegin(), times.cend(), 0.0, [&result](double sum, double time) { return sum + (time - result._mean) * (time - result._mean); }) / (times.size() - 1));
+		result._min = *std::min_element(times.cbegin(), times.cend());
+		return result;
+	}
+
+	// Returns the peak resident set size of the process in KiB.
+	uint64_t peakRssKib()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters{};
+		return ::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof counters) ? counters.PeakWorkingSetSize / 1024 : 0;
+#else
+		rusage usage{};
+		if (::getrusage(RUSAGE_SELF, &usage))
+			return 0;
+#	ifdef __APPLE__
+		return static_cast<uint64_t>(usage.ru_maxrss) / 1024; // Bytes on macOS.
+#	else
+		return static_cast<uint64_t>(usage.ru_maxrss);
+#	endif
+#endif
+	}
+
+	size_t renderAll(const seir::synth::Composition& composition, const seir::synth::AudioFormat& format, std::vector<float>& buffer)
+	{
+		const auto renderer = seir::synth::Renderer::create(composition, format, false);
+		size_t totalFrames = 0;
+		while (const auto frames = renderer->render(buffer.data(), kBufferFrames))
+			totalFrames += frames;
+		return totalFrames;
+	}
+
+	class Report
+	{
+	public:
+		explicit Report(bool csv)
+			: _csv{ csv }
+		{
+			if (_csv)
+				std::cout << "file,pass,rate,channels,frames,mean_ms,stddev_ms,min_ms,realtime_factor,frames_per_second,peak_rss_kib\n";
+			else
+				std::cout << std::left << std::setw(32) << "file" << std::setw(8) << "pass" << std::right << std::setw(8) << "rate" << std::setw(9) << "channels"
+						  << std::setw(12) << "frames" << std::setw(12) << "mean ms" << std::setw(10) << "stddev" << std::setw(10) << "RTF"
+						  << std::setw(14) << "frames/s" << std::setw(12) << "peak RSS" << "\n";
+		}
+
+		// The realtime factor is how many times faster than realtime the pass is.
+		void add(std::string_view file, std::string_view pass, unsigned samplingRate, std::string_view channels, size_t frames, double duration, const Statistics& statistics)
+		{
+			const auto seconds = statistics._mean / 1000;
+			const auto realtimeFactor = duration / seconds;
+			const auto framesPerSecond = frames / seconds;
+			const auto peakRss = ::peakRssKib();
+			if (_csv)
+				std::cout << file << ',' << pass << ',' << samplingRate << ',' << channels << ',' << frames << ',' << std::fixed << std::setprecision(3)
+						  << statistics._mean << ',' << statistics._stddev << ',' << statistics._min << ',' << std::setprecision(1) << realtimeFactor << ','
+						  << std::setprecision(0) << framesPerSecond << ',' << peakRss << "\n";
+			else
+				std::cout << std::left << std::setw(32) << file << std::setw(8) << pass << std::right << std::setw(8) << samplingRate << std::setw(9) << channels
+						  << std::setw(12) << frames << std::fixed << std::setprecision(3) << std::setw(12) << statistics._mean
+						  << std::setw(9) << std::setprecision(1) << (statistics._mean > 0 ? statistics._stddev * 100 / statistics._mean : 0.0) << '%'
+						  << std::setw(9) << realtimeFactor << 'x' << std::setw(14) << std::setprecision(0) << framesPerSecond
+						  << std::setw(8) << peakRss / 1024 << " MiB\n";
+		}
+
+	private:
+		const bool _csv;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	size_t iterations = 5;
+	bool csv = false;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg{ argv[i] };
+		if ((arg == "-i" || arg == "--iterations") && i + 1 < argc)
+			iterations = std::max<size_t>(std::stoul(argv[++i]), 1);
+		else if (arg == "--csv")
+			csv = true;
+		else if (arg == "-h" || arg == "--help")
+		{
+			std::cout << "Usage: aulos_render_benchmark [-i ITERATIONS] [--csv] [FILE...]\n"
+						 "Measure rendering performance at every sampling rate and channel layout the Studio supports.\n"
+						 "Renders the bundled examples if no files are specified.\n"
+						 "The 'gain' pass is the amplitude measurement done by packComposition().\n";
+			return 0;
+		}
+		else
+			inputs.emplace_back(std::filesystem::path{ arg });
+	}
+	if (inputs.empty())
+	{
+		for (const auto& entry : std::filesystem::directory_iterator{ AULOS_EXAMPLES_DIR })
+			if (entry.path().extension() == ".aulos")
+				inputs.emplace_back(entry.path());
+		std::sort(inputs.begin(), inputs.end());
+	}
+
+	Report report{ csv };
+	std::vector<float> buffer(kBufferFrames * 2);
+	bool failed = false;
+	for (const auto& input : inputs)
+	{
+		std::string error;
+		const auto data = aulos::loadCompositionData(input, error);
+		if (!data)
+		{
+			std::cerr << input.string() << ": " << error << "\n";
+			failed = true;
+			continue;
+		}
+		const auto file = input.filename().string();
+
+		std::unique_ptr<seir::synth::Composition> composition;
+		const auto gainStatistics = ::measure(iterations, [&data, &composition] { composition = aulos::packComposition(*data); });
+		if (!composition)
+		{
+			std::cerr << input.string() << ": Unable to pack composition\n";
+			failed = true;
+			continue;
+		}
+
+		double duration = 0;
+		for (const auto samplingRate : kSamplingRates)
+		{
+			for (const auto channelLayout : { seir::synth::ChannelLayout::Mono, seir::synth::ChannelLayout::Stereo })
+			{
+				const seir::synth::AudioFormat format{ samplingRate, channelLayout };
+				size_t frames = 0;
+				const auto statistics = ::measure(iterations, [&] { frames = ::renderAll(*composition, format, buffer); });
+				duration = static_cast<double>(frames) / samplingRate;
+				report.add(file, "render", samplingRate, channelLayout == seir::synth::ChannelLayout::Mono ? "mono" : "stereo", frames, duration, statistics);
+			}
+		}
+
+		// The gain is measured by rendering in mono at the maximum sampling rate.
+		const auto gainFrames = static_cast<size_t>(std::lround(duration * seir::synth::Renderer::kMaxSamplingRate));
+		report.add(file, "gain", seir::synth::Renderer::kMaxSamplingRate, "mono", gainFrames, duration, gainStatistics);
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,206 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "composition/composition_model.hpp"
+#include "composition/composition_scene.hpp"
+#include "theme.hpp"
+
+#include <aulos_core/composition.hpp>
+
+#include <seir_synth/data.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int kViewWidth = 1280;
+	constexpr int kViewHeight = 720;
+	constexpr int kZoomLevels[]{ 0, -3, kMinZoomLevel };
+
+	struct Statistics
+	{
+		double _mean = 0;   // Milliseconds.
+		double _stddev = 0; // Milliseconds.
+		double _min = 0;    // Milliseconds.
+	};
+
+	template <typename Function>
+	Statistics measure(size_t iterations, Function&& function)
+	{
+		std::vector<double> times;
+		times.reserve(iterations);
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			const auto start = Clock::now();
+			function();
+			times.emplace_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		Statistics result;
+		result._mean = std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+		if (times.size() > 1)
+			result._stddev = std::sqrt(std::accumulate(times.cbegin(), times.cend(), 0.0, [&result](double sum, double time) { return sum + (time - result._mean) * (time - result._mean); }) / (times.size() - 1));
+		result._min = *std::min_element(times.cbegin(), times.cend());
+		return result;
+	}
+
+	// Repeats all fragments of the composition, so that it becomes long enough to expose painting costs which depend on the composition length.
+	void repeatComposition(seir::synth::CompositionData& composition, size_t times)
+	{
+		size_t length = 0;
+		for (const auto& part : composition._parts)
+			for (const auto& track : part->_tracks)
+				if (!track->_fragments.empty())
+				{
+					const auto& lastFragment = *track->_fragments.rbegin();
+					const auto& sounds = lastFragment.second->_sounds;
+					const auto sequenceLength = std::accumulate(sounds.begin(), sounds.end(), size_t{ 1 }, [](size_t length, const seir::synth::Sound& sound) { return length + sound._delay + sound._sustain; });
+					length = std::max(length, lastFragment.first + sequenceLength);
+				}
+		for (const auto& part : composition._parts)
+			for (const auto& track : part->_tracks)
+			{
+				const auto fragments = track->_fragments;
+				for (size_t i = 1; i < times; ++i)
+					for (const auto& fragment : fragments)
+						track->_fragments.emplace(fragment.first + i * length, fragment.second);
+			}
+	}
+
+	void renderScene(CompositionScene& scene, QImage& image, const QRectF& source)
+	{
+		image.fill(Qt::transparent);
+		QPainter painter{ &image };
+		scene.render(&painter, QRectF{ image.rect() }, source, Qt::IgnoreAspectRatio);
+	}
+
+	class Report
+	{
+	public:
+		explicit Report(bool csv)
+			: _csv{ csv }
+		{
+			if (_csv)
+				std::cout << "file,zoom,area,scene_width,mean_ms,stddev_ms,min_ms\n";
+			else
+				std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(6) << "zoom" << "  " << std::left << std::setw(10) << "area"
+						  << std::right << std::setw(12) << "width" << std::setw(12) << "mean ms" << std::setw(10) << "stddev" << std::setw(12) << "min ms" << "\n";
+		}
+
+		void add(std::string_view file, int zoomLevel, std::string_view area, qreal sceneWidth, const Statistics& statistics)
+		{
+			if (_csv)
+				std::cout << file << ',' << zoomLevel << ',' << area << ',' << std::fixed << std::setprecision(0) << sceneWidth << ','
+						  << std::setprecision(3) << statistics._mean << ',' << statistics._stddev << ',' << statistics._min << "\n";
+			else
+				std::cout << std::left << std::setw(40) << file << std::right << std::setw(6) << zoomLevel << "  " << std::left << std::setw(10) << area
+						  << std::right << std::fixed << std::setprecision(0) << std::setw(12) << sceneWidth << std::setprecision(3) << std::setw(12) << statistics._mean
+						  << std::setw(9) << std::setprecision(1) << (statistics._mean > 0 ? statistics._stddev * 100 / statistics._mean : 0.0) << '%'
+						  << std::setprecision(3) << std::setw(12) << statistics._min << "\n";
+		}
+
+	private:
+		const bool _csv;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	size_t iterations = 50;
+	size_t repeats = 16;
+	bool csv = false;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg{ argv[i] };
+		if ((arg == "-i" || arg == "--iterations") && i + 1 < argc)
+			iterations = std::max<size_t>(std::stoul(argv[++i]), 1);
+		else if ((arg == "-r" || arg == "--repeat") && i + 1 < argc)
+			repeats = std::max<size_t>(std::stoul(argv[++i]), 1);
+		else if (arg == "--csv")
+			csv = true;
+		else if (arg == "-h" || arg == "--help")
+		{
+			std::cout << "Usage: aulos_scene_benchmark [-i ITERATIONS] [-r REPEAT] [--csv] [FILE...]\n"
+						 "Measure composition scene painting performance at several zoom levels.\n"
+						 "Paints the bundled examples if no files are specified.\n"
+						 "Every composition is also painted with its fragments repeated REPEAT times (default: 16).\n"
+						 "The 'start' and 'end' areas are views at the ends of the composition,\n"
+						 "the 'timeline' area is the timeline part of the 'end' view.\n";
+			return 0;
+		}
+		else
+			inputs.emplace_back(std::filesystem::path{ arg });
+	}
+	if (inputs.empty())
+	{
+		for (const auto& entry : std::filesystem::directory_iterator{ AULOS_EXAMPLES_DIR })
+			if (entry.path().extension() == ".aulos")
+				inputs.emplace_back(entry.path());
+		std::sort(inputs.begin(), inputs.end());
+	}
+
+	// Painting is done into images, so no display is required.
+	if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication application{ argc, argv };
+
+	Report report{ csv };
+	QImage viewImage{ kViewWidth, kViewHeight, QImage::Format_ARGB32_Premultiplied };
+	QImage timelineImage{ kViewWidth, static_cast<int>(kCompositionHeaderHeight), QImage::Format_ARGB32_Premultiplied };
+	bool failed = false;
+	for (const auto& input : inputs)
+	{
+		for (const auto repeat : { size_t{ 1 }, repeats })
+		{
+			std::string error;
+			const auto data = aulos::loadCompositionData(input, error);
+			if (!data)
+			{
+				std::cerr << input.string() << ": " << error << "\n";
+				failed = true;
+				break;
+			}
+			::repeatComposition(*data, repeat);
+			const auto file = repeat > 1 ? input.filename().string() + " x" + std::to_string(repeat) : input.filename().string();
+
+			CompositionModel model;
+			model.reset(data);
+			CompositionScene scene{ model };
+			scene.setVisibleRect({ 0, 0, kViewWidth, kViewHeight });
+			scene.reset();
+			for (const auto zoomLevel : kZoomLevels)
+			{
+				scene.setStepWidth(kStepWidth * std::ldexp(1.0, zoomLevel));
+				const auto sceneWidth = scene.sceneRect().width();
+				const QRectF startRect{ 0, 0, kViewWidth, kViewHeight };
+				const QRectF endRect{ std::max(sceneWidth - kViewWidth, qreal{ 0 }), 0, kViewWidth, kViewHeight };
+				const QRectF timelineRect{ endRect.topLeft(), QSizeF{ kViewWidth, kCompositionHeaderHeight } };
+				const auto run = [&](std::string_view area, const QRectF& visibleRect, QImage& image, const QRectF& source) {
+					scene.setVisibleRect(visibleRect);
+					::renderScene(scene, image, source); // Warms up the caches.
+					report.add(file, zoomLevel, area, sceneWidth, ::measure(iterations, [&] { ::renderScene(scene, image, source); }));
+				};
+				run("start", startRect, viewImage, startRect);
+				run("end", endRect, viewImage, endRect);
+				run("timeline", endRect, timelineImage, timelineRect);
+			}
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <seir_synth/data.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+// The binary format stores the same data as the text one (so they can be converted into each other losslessly),
+// but is more compact and is decoded straight into the editable data, without a packed composition in between.
+// It consists of:
+// * an 8-byte signature ("AULOSB", a zero byte and a format version byte);
+// * composition properties (speed, loop, gain divisor, title, author);
+// * parts, each consisting of a voice name, voice parameters and tracks;
+// * tracks, each consisting of track properties, a sequence table and a fragment table,
+//   fragments referencing sequences by index and storing offsets relative to the previous fragment.
+// Integers are LEB128 varints (signed ones are zigzag-encoded), floats are little-endian IEEE 754.
+namespace aulos
+{
+	class Sink;
+
+	// Returns true if the data starts with the binary format signature.
+	bool isBinaryComposition(std::span<const std::byte>) noexcept;
+
+	// Decodes a binary composition, returns null and sets the error message if the data is malformed.
+	std::shared_ptr<seir::synth::CompositionData> loadBinaryComposition(std::span<const std::byte>, std::string& error);
+
+	// Writes the composition into the sink in the binary format.
+	// Fails if a fragment references a sequence which is not in the sequence table of its track.
+	bool saveBinaryComposition(const seir::synth::CompositionData&, Sink&);
+}
@@ -0,0 +1,85 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/format.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace seir::synth
+{
+	struct CompositionData;
+}
+
+namespace aulos
+{
+	class Sink;
+
+	// Remembers the amplitude of the last measured composition, so that an unchanged composition
+	// can be packed or exported again without rendering it to measure the gain.
+	class GainCache
+	{
+	public:
+		// Returns the amplitude of the composition (packed with unit gain divisor) if it's the one measured last time.
+		std::optional<float> find(const seir::synth::Composition&) const;
+
+		// Packs the composition with the gain divisor set to the maximum amplitude of the output,
+		// measuring the amplitude only if the composition has changed since the last time.
+		std::unique_ptr<seir::synth::Composition> pack(seir::synth::CompositionData&);
+
+		// Stores the amplitude of the composition (packed with unit gain divisor) measured elsewhere.
+		void store(const seir::synth::Composition&, float amplitude);
+
+	private:
+		uint64_t _key = 0;
+		std::optional<float> _amplitude;
+	};
+
+	struct LoadTimings
+	{
+		std::chrono::nanoseconds _read{ 0 };    // Reading the whole file into memory.
+		std::chrono::nanoseconds _parse{ 0 };   // Parsing text into a packed composition, or decoding binary data.
+		std::chrono::nanoseconds _convert{ 0 }; // Unpacking a parsed text composition into editable data.
+	};
+
+	// Makes a deep copy of the composition data which shares nothing with the original,
+	// so that it can be saved on another thread while the original is being edited.
+	std::shared_ptr<seir::synth::CompositionData> copyCompositionData(const seir::synth::CompositionData&);
+
+	// Loads a composition from a text or binary file.
+	// Returns null and sets the error message if the file can't be read or parsed.
+	std::unique_ptr<seir::synth::Composition> loadComposition(const std::filesystem::path&, std::string& error);
+
+	// Loads a composition for editing from a text or binary file.
+	// The file is read into memory with a single read. Binary files are decoded directly into the editable data,
+	// while text files are parsed into a packed composition first (the only form the text parser produces),
+	// and both the text and the packed composition are released as soon as the data is built.
+	std::shared_ptr<seir::synth::CompositionData> loadCompositionData(const std::filesystem::path&, std::string& error, LoadTimings* = nullptr);
+
+	// Renders the composition and returns the maximum absolute sample value.
+	// The callback is called with the number of frames rendered so far (at the maximum sampling rate),
+	// and the measurement is aborted if it returns false.
+	std::optional<float> measureAmplitude(const seir::synth::Composition&, const std::function<bool(size_t)>& progressCallback = {});
+
+	// Repacks a composition which was packed with unit gain divisor, setting the divisor to the specified amplitude.
+	std::unique_ptr<seir::synth::Composition> normalizeComposition(const seir::synth::Composition&, float amplitude);
+
+	// Packs the composition with the gain divisor set to the maximum amplitude of the output.
+	std::unique_ptr<seir::synth::Composition> packComposition(seir::synth::CompositionData&);
+
+	// Returns a hash identifying the output of rendering the composition in the specified format.
+	// Intended for content-addressed caching of rendered data.
+	uint64_t renderKey(const seir::synth::Composition&, const seir::synth::AudioFormat&);
+
+	// Writes the composition into the sink in the text format.
+	bool saveComposition(const seir::synth::Composition&, Sink&);
+}
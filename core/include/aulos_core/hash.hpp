@@ -0,0 +1,37 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace aulos
+{
+	// 64-bit FNV-1a hash for content-addressed caching.
+	// Not suitable for anything that needs to withstand deliberate collisions.
+	class Hash
+	{
+	public:
+		Hash& add(const void* data, size_t size) noexcept
+		{
+			for (auto i = static_cast<const unsigned char*>(data), end = i + size; i != end; ++i)
+				_value = (_value ^ *i) * 0x100000001b3;
+			return *this;
+		}
+
+		Hash& add(std::string_view text) noexcept { return add(text.data(), text.size()); }
+
+		template <typename T>
+		requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+		Hash& add(T value) noexcept { return add(&value, sizeof value); }
+
+		constexpr uint64_t value() const noexcept { return _value; }
+
+	private:
+		uint64_t _value = 0xcbf29ce484222325;
+	};
+}
@@ -0,0 +1,64 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aulos
+{
+	// Writes data blocks on a separate thread so that producing the data overlaps with writing it.
+	// The producer acquires a block, fills it and submits it; at most blockCount blocks are in flight.
+	class PipelinedWriter
+	{
+	public:
+		static constexpr size_t kDefaultBlockSize = size_t{ 1 } << 20;
+		static constexpr size_t kDefaultBlockCount = 3;
+
+		// The sink is called on the writer thread and returns false if writing failed.
+		using Sink = std::function<bool(const std::byte* data, size_t size)>;
+
+		explicit PipelinedWriter(Sink&&, size_t blockSize = kDefaultBlockSize, size_t blockCount = kDefaultBlockCount);
+		~PipelinedWriter() noexcept;
+
+		// Returns a free block of blockSize() bytes, waiting for the writer thread if there are none.
+		std::byte* acquire();
+		constexpr size_t blockSize() const noexcept { return _blockSize; }
+		// Waits for all submitted blocks to be written and stops the writer thread.
+		// Returns false if any of the writes failed.
+		bool finish();
+		// Queues the first 'size' bytes of the acquired block for writing.
+		// Returns false if a previous write has failed, in which case there's no point in producing more data.
+		bool submit(std::byte* block, size_t size);
+
+	private:
+		struct Block
+		{
+			std::byte* _data = nullptr;
+			size_t _size = 0;
+		};
+
+		void run();
+
+	private:
+		const Sink _sink;
+		const size_t _blockSize;
+		std::vector<std::unique_ptr<std::byte[]>> _storage;
+		std::mutex _mutex;
+		std::condition_variable _freeCondition;
+		std::condition_variable _queueCondition;
+		std::vector<std::byte*> _freeBlocks;
+		std::deque<Block> _queue;
+		bool _finishing = false;
+		bool _failed = false;
+		std::thread _thread;
+	};
+}
@@ -0,0 +1,46 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/pipelined_writer.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/format.hpp>
+
+#include <cstddef>
+#include <functional>
+
+namespace aulos
+{
+	class Sink;
+
+	enum class OutputFormat
+	{
+		Wav, // WAV file with IEEE float samples.
+		Raw, // Headerless interleaved 32-bit float samples.
+	};
+
+	enum class RenderStatus
+	{
+		Completed,
+		Cancelled,
+		Failed,
+	};
+
+	struct RenderOptions
+	{
+		OutputFormat _outputFormat = OutputFormat::Wav;
+		// Rendered data is written to the sink in blocks of this size (rounded down to whole frames).
+		size_t _blockSize = PipelinedWriter::kDefaultBlockSize;
+		// Called after every block with the number of frames rendered so far.
+		// Rendering is cancelled if the callback returns false.
+		std::function<bool(size_t)> _progressCallback;
+	};
+
+	// Renders the whole composition into the sink, writing each block while the next one is being rendered.
+	// The sink is written to on a separate thread, but never concurrently.
+	// If the sink isn't seekable, the WAV header specifies the maximum data size instead of the actual one.
+	RenderStatus render(const seir::synth::Composition&, const seir::synth::AudioFormat&, Sink&, const RenderOptions& = {});
+}
@@ -0,0 +1,65 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace aulos
+{
+	// Destination for serialized or rendered data.
+	class Sink
+	{
+	public:
+		virtual ~Sink() noexcept = default;
+
+		// Returns true if the write position can be changed.
+		virtual bool isSeekable() const noexcept = 0;
+		// Sets the position for subsequent writes, returns false on failure.
+		virtual bool seek(uint64_t offset) = 0;
+		// Writes data at the current position, returns false on failure.
+		virtual bool write(const void* data, size_t size) = 0;
+	};
+
+	// Writes into a temporary file which replaces the target file only on commit,
+	// so that the target file is never left in a partially written state.
+	class FileSink final : public Sink
+	{
+	public:
+		explicit FileSink(const std::filesystem::path&);
+		~FileSink() noexcept override;
+
+		bool commit();
+		bool isOpen() const noexcept { return _stream.is_open(); }
+
+		bool isSeekable() const noexcept override { return true; }
+		bool seek(uint64_t offset) override;
+		bool write(const void* data, size_t size) override;
+
+	private:
+		const std::filesystem::path _path;
+		const std::filesystem::path _temporaryPath;
+		std::ofstream _stream;
+	};
+
+	// Accumulates data in memory.
+	class MemorySink final : public Sink
+	{
+	public:
+		const std::vector<std::byte>& data() const noexcept { return _data; }
+		std::vector<std::byte> release() noexcept;
+
+		bool isSeekable() const noexcept override { return true; }
+		bool seek(uint64_t offset) override;
+		bool write(const void* data, size_t size) override;
+
+	private:
+		std::vector<std::byte> _data;
+		size_t _position = 0;
+	};
+}
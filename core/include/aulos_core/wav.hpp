@@ -0,0 +1,19 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <seir_synth/format.hpp>
+
+#include <array>
+#include <cstddef>
+
+namespace aulos
+{
+	constexpr size_t kWavHeaderSize = 44;
+
+	// Returns a WAV file header for IEEE float PCM data of the specified size.
+	// The header may be written with zero data size first and rewritten when the size is known.
+	std::array<std::byte, kWavHeaderSize> makeWavHeader(const seir::synth::AudioFormat&, size_t dataSize);
+}
@@ -0,0 +1,448 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/binary.hpp>
+
+#include <aulos_core/sink.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	constexpr std::array<char, 8> kSignature{ 'A', 'U', 'L', 'O', 'S', 'B', '\0', '\1' };
+	constexpr size_t kWriteBufferSize = size_t{ 1 } << 16;
+
+	class BinaryWriter
+	{
+	public:
+		explicit BinaryWriter(aulos::Sink& sink)
+			: _sink{ sink }
+		{
+			_buffer.reserve(kWriteBufferSize);
+		}
+
+		bool finish()
+		{
+			flush();
+			return !_failed;
+		}
+
+		template <typename T>
+		void write(T value)
+		{
+			if constexpr (std::is_enum_v<T>)
+				writeUnsigned(static_cast<uint64_t>(value));
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				static_assert(sizeof(float) == sizeof(uint32_t));
+				const auto bits = std::bit_cast<uint32_t>(static_cast<float>(value));
+				for (int i = 0; i < 4; ++i)
+					_buffer.push_back(static_cast<std::byte>(bits >> (8 * i)));
+			}
+			else if constexpr (std::is_signed_v<T>)
+			{
+				const auto extended = static_cast<int64_t>(value);
+				writeUnsigned((static_cast<uint64_t>(extended) << 1) ^ static_cast<uint64_t>(extended >> 63));
+			}
+			else
+				writeUnsigned(static_cast<uint64_t>(value));
+			if (_buffer.size() >= kWriteBufferSize)
+				flush();
+		}
+
+		void write(const std::string& text)
+		{
+			writeUnsigned(text.size());
+			const auto bytes = reinterpret_cast<const std::byte*>(text.data());
+			_buffer.insert(_buffer.end(), bytes, bytes + text.size());
+			if (_buffer.size() >= kWriteBufferSize)
+				flush();
+		}
+
+	private:
+		void flush()
+		{
+			if (!_failed && !_buffer.empty() && !_sink.write(_buffer.data(), _buffer.size()))
+				_failed = true;
+			_buffer.clear();
+		}
+
+		void writeUnsigned(uint64_t value)
+		{
+			for (; value >= 0x80; value >>= 7)
+				_buffer.push_back(static_cast<std::byte>(value | 0x80));
+			_buffer.push_back(static_cast<std::byte>(value));
+		}
+
+	private:
+		aulos::Sink& _sink;
+		std::vector<std::byte> _buffer;
+		bool _failed = false;
+	};
+
+	class BinaryReader
+	{
+	public:
+		explicit BinaryReader(std::span<const std::byte> data) noexcept
+			: _current{ data.data() }
+			, _end{ data.data() + data.size() }
+		{
+		}
+
+		constexpr bool failed() const noexcept { return _failed; }
+		constexpr size_t remaining() const noexcept { return static_cast<size_t>(_end - _current); }
+
+		// Reads an element count which can't exceed the number of remaining bytes, preventing huge allocations on malformed data.
+		size_t readCount() noexcept
+		{
+			const auto count = readUnsigned();
+			if (count <= remaining())
+				return static_cast<size_t>(count);
+			_failed = true;
+			return 0;
+		}
+
+		template <typename T>
+		void read(T& value) noexcept
+		{
+			if constexpr (std::is_enum_v<T>)
+				value = static_cast<T>(readUnsigned());
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				if (remaining() < 4)
+				{
+					_failed = true;
+					return;
+				}
+				uint32_t bits = 0;
+				for (int i = 0; i < 4; ++i)
+					bits |= static_cast<uint32_t>(_current[i]) << (8 * i);
+				_current += 4;
+				value = static_cast<T>(std::bit_cast<float>(bits));
+			}
+			else if constexpr (std::is_signed_v<T>)
+			{
+				const auto encoded = readUnsigned();
+				value = static_cast<T>(static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1));
+			}
+			else
+				value = static_cast<T>(readUnsigned());
+		}
+
+		void read(std::string& text)
+		{
+			const auto size = readCount();
+			text.assign(reinterpret_cast<const char*>(_current), size);
+			_current += size;
+		}
+
+	private:
+		uint64_t readUnsigned() noexcept
+		{
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				if (_current == _end)
+					break;
+				const auto byte = static_cast<uint64_t>(*_current++);
+				value |= (byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			_failed = true;
+			return 0;
+		}
+
+	private:
+		const std::byte* _current;
+		const std::byte* const _end;
+		bool _failed = false;
+	};
+
+	void writeEnvelope(BinaryWriter& writer, const seir::synth::Envelope& envelope)
+	{
+		writer.write(envelope._changes.size());
+		for (const auto& change : envelope._changes)
+		{
+			writer.write(change._duration.count());
+			writer.write(change._value);
+		}
+		writer.write(envelope._sustainIndex);
+	}
+
+	void writeOscillation(BinaryWriter& writer, const seir::synth::Oscillation& oscillation)
+	{
+		writer.write(oscillation._frequency);
+		writer.write(oscillation._magnitude);
+	}
+
+	void writeVoice(BinaryWriter& writer, const seir::synth::VoiceData& voice)
+	{
+		writer.write(voice._waveShape);
+		writer.write(voice._waveShapeParameters._shape1);
+		writer.write(voice._waveShapeParameters._shape2);
+		::writeEnvelope(writer, voice._amplitudeEnvelope);
+		::writeOscillation(writer, voice._tremolo);
+		::writeEnvelope(writer, voice._frequencyEnvelope);
+		::writeOscillation(writer, voice._vibrato);
+		::writeEnvelope(writer, voice._asymmetryEnvelope);
+		::writeOscillation(writer, voice._asymmetryOscillation);
+		::writeEnvelope(writer, voice._rectangularityEnvelope);
+		::writeOscillation(writer, voice._rectangularityOscillation);
+	}
+
+	bool writeTrack(BinaryWriter& writer, const seir::synth::TrackData& track)
+	{
+		writer.write(track._properties->_weight);
+		writer.write(track._properties->_polyphony);
+		writer.write(track._properties->_headDelay);
+		writer.write(track._properties->_sourceDistance);
+		writer.write(track._properties->_sourceWidth);
+		writer.write(track._properties->_sourceOffset);
+		std::unordered_map<const seir::synth::SequenceData*, size_t> sequenceIndices;
+		sequenceIndices.reserve(track._sequences.size());
+		writer.write(track._sequences.size());
+		for (const auto& sequence : track._sequences)
+		{
+			sequenceIndices.emplace(sequence.get(), sequenceIndices.size());
+			writer.write(sequence->_sounds.size());
+			for (const auto& sound : sequence->_sounds)
+			{
+				writer.write(sound._delay); // Sound delays are already relative to the previous sound.
+				writer.write(sound._note);
+				writer.write(sound._sustain);
+			}
+		}
+		writer.write(track._fragments.size());
+		size_t lastOffset = 0;
+		for (const auto& [offset, sequence] : track._fragments)
+		{
+			const auto i = sequenceIndices.find(sequence.get());
+			if (i == sequenceIndices.end())
+				return false; // Fragments can only reference sequences from the track's sequence table.
+			writer.write(offset - lastOffset);
+			writer.write(i->second);
+			lastOffset = offset;
+		}
+		return true;
+	}
+
+	// Reads an enumeration value, returns false if it's out of range.
+	template <typename T>
+	bool readEnum(BinaryReader& reader, T& value, T last) noexcept
+	{
+		uint64_t raw = 0;
+		reader.read(raw);
+		value = static_cast<T>(raw);
+		return raw <= static_cast<uint64_t>(last);
+	}
+
+	bool readEnvelope(BinaryReader& reader, seir::synth::Envelope& envelope, std::string& error)
+	{
+		const auto count = reader.readCount();
+		envelope._changes.reserve(count);
+		for (size_t i = 0; i < count && !reader.failed(); ++i)
+		{
+			std::chrono::milliseconds::rep duration = 0;
+			float value = 0;
+			reader.read(duration);
+			reader.read(value);
+			if (duration < 0 || duration > seir::synth::EnvelopeChange::kMaxDuration.count())
+			{
+				error = "Invalid envelope duration";
+				return false;
+			}
+			envelope._changes.emplace_back(std::chrono::milliseconds{ duration }, value);
+		}
+		reader.read(envelope._sustainIndex);
+		if (envelope._sustainIndex > envelope._changes.size()) // Zero means no sustain, otherwise it's the index of the change plus one.
+		{
+			error = "Invalid envelope sustain";
+			return false;
+		}
+		return true;
+	}
+
+	void readOscillation(BinaryReader& reader, seir::synth::Oscillation& oscillation)
+	{
+		reader.read(oscillation._frequency);
+		reader.read(oscillation._magnitude);
+	}
+
+	bool readVoice(BinaryReader& reader, seir::synth::VoiceData& voice, std::string& error)
+	{
+		if (!::readEnum(reader, voice._waveShape, seir::synth::WaveShape::CosineCubed))
+		{
+			error = "Invalid wave shape";
+			return false;
+		}
+		reader.read(voice._waveShapeParameters._shape1);
+		reader.read(voice._waveShapeParameters._shape2);
+		if (!::readEnvelope(reader, voice._amplitudeEnvelope, error))
+			return false;
+		::readOscillation(reader, voice._tremolo);
+		if (!::readEnvelope(reader, voice._frequencyEnvelope, error))
+			return false;
+		::readOscillation(reader, voice._vibrato);
+		if (!::readEnvelope(reader, voice._asymmetryEnvelope, error))
+			return false;
+		::readOscillation(reader, voice._asymmetryOscillation);
+		if (!::readEnvelope(reader, voice._rectangularityEnvelope, error))
+			return false;
+		::readOscillation(reader, voice._rectangularityOscillation);
+		return true;
+	}
+
+	bool readTrack(BinaryReader& reader, seir::synth::TrackData& track, std::string& error)
+	{
+		reader.read(track._properties->_weight);
+		if (!track._properties->_weight && !reader.failed())
+		{
+			error = "Invalid track weight";
+			return false;
+		}
+		if (!::readEnum(reader, track._properties->_polyphony, seir::synth::Polyphony::Full))
+		{
+			error = "Invalid polyphony";
+			return false;
+		}
+		reader.read(track._properties->_headDelay);
+		reader.read(track._properties->_sourceDistance);
+		reader.read(track._properties->_sourceWidth);
+		reader.read(track._properties->_sourceOffset);
+		const auto sequenceCount = reader.readCount();
+		track._sequences.reserve(sequenceCount);
+		for (size_t i = 0; i < sequenceCount && !reader.failed(); ++i)
+		{
+			const auto& sequence = track._sequences.emplace_back(std::make_shared<seir::synth::SequenceData>());
+			const auto soundCount = reader.readCount();
+			sequence->_sounds.reserve(soundCount);
+			for (size_t j = 0; j < soundCount && !reader.failed(); ++j)
+			{
+				decltype(seir::synth::Sound::_delay) delay{};
+				decltype(seir::synth::Sound::_note) note{};
+				decltype(seir::synth::Sound::_sustain) sustain{};
+				reader.read(delay);
+				reader.read(note);
+				reader.read(sustain);
+				if (static_cast<size_t>(note) >= seir::synth::kNoteCount)
+				{
+					error = "Invalid note";
+					return false;
+				}
+				if (sustain > seir::synth::kMaxSustain)
+				{
+					error = "Invalid sustain";
+					return false;
+				}
+				sequence->_sounds.emplace_back(delay, note, sustain);
+			}
+		}
+		const auto fragmentCount = reader.readCount();
+		size_t offset = 0;
+		for (size_t i = 0; i < fragmentCount && !reader.failed(); ++i)
+		{
+			size_t delta = 0;
+			size_t index = 0;
+			reader.read(delta);
+			reader.read(index);
+			if (index >= track._sequences.size() || (i > 0 && !delta))
+			{
+				error = "Invalid fragment";
+				return false;
+			}
+			offset += delta;
+			track._fragments.emplace_hint(track._fragments.end(), offset, track._sequences[index]);
+		}
+		return true;
+	}
+}
+
+namespace aulos
+{
+	bool isBinaryComposition(std::span<const std::byte> data) noexcept
+	{
+		return data.size() >= kSignature.size() && !std::memcmp(data.data(), kSignature.data(), kSignature.size());
+	}
+
+	std::shared_ptr<seir::synth::CompositionData> loadBinaryComposition(std::span<const std::byte> data, std::string& error)
+	{
+		if (!isBinaryComposition(data))
+		{
+			error = "Not a binary composition";
+			return {};
+		}
+		BinaryReader reader{ data.subspan(kSignature.size()) };
+		auto composition = std::make_shared<seir::synth::CompositionData>();
+		reader.read(composition->_speed);
+		if (!composition->_speed && !reader.failed())
+		{
+			error = "Invalid speed";
+			return {};
+		}
+		reader.read(composition->_loopOffset);
+		reader.read(composition->_loopLength);
+		reader.read(composition->_gainDivisor);
+		reader.read(composition->_title);
+		reader.read(composition->_author);
+		const auto partCount = reader.readCount();
+		composition->_parts.reserve(partCount);
+		for (size_t i = 0; i < partCount && !reader.failed(); ++i)
+		{
+			const auto& part = composition->_parts.emplace_back(std::make_shared<seir::synth::PartData>(std::make_shared<seir::synth::VoiceData>()));
+			reader.read(part->_voiceName);
+			if (!::readVoice(reader, *part->_voice, error))
+				return {};
+			const auto trackCount = reader.readCount();
+			part->_tracks.reserve(trackCount);
+			for (size_t j = 0; j < trackCount && !reader.failed(); ++j)
+			{
+				const auto& track = part->_tracks.emplace_back(std::make_shared<seir::synth::TrackData>(std::make_shared<seir::synth::TrackProperties>()));
+				if (!::readTrack(reader, *track, error))
+					return {};
+			}
+		}
+		if (reader.failed())
+		{
+			error = "Unexpected end of data";
+			return {};
+		}
+		if (reader.remaining() > 0)
+		{
+			error = "Unexpected data after the end of composition";
+			return {};
+		}
+		return composition;
+	}
+
+	bool saveBinaryComposition(const seir::synth::CompositionData& composition, Sink& sink)
+	{
+		if (!sink.write(kSignature.data(), kSignature.size()))
+			return false;
+		BinaryWriter writer{ sink };
+		writer.write(composition._speed);
+		writer.write(composition._loopOffset);
+		writer.write(composition._loopLength);
+		writer.write(composition._gainDivisor);
+		writer.write(composition._title);
+		writer.write(composition._author);
+		writer.write(composition._parts.size());
+		for (const auto& part : composition._parts)
+		{
+			writer.write(part->_voiceName);
+			::writeVoice(writer, *part->_voice);
+			writer.write(part->_tracks.size());
+			for (const auto& track : part->_tracks)
+				if (!::writeTrack(writer, *track))
+					return false;
+		}
+		return writer.finish();
+	}
+}
@@ -0,0 +1,241 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/composition.hpp>
+
+#include <aulos_core/binary.hpp>
+#include <aulos_core/hash.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr size_t kBufferSize = 8192;
+
+	// The whole file is read into a string with a single read, which gives the text parser the null terminator it requires
+	// and keeps the data stable even if the file is being rewritten by another program (which is when the Studio reloads it).
+	bool readFile(const std::filesystem::path& path, std::string& buffer, std::string& error)
+	{
+		std::ifstream stream{ path, std::ios::binary | std::ios::ate };
+		const auto size = stream.tellg();
+		if (!stream || size < 0)
+		{
+			error = "Unable to open file";
+			return false;
+		}
+		buffer.resize(static_cast<size_t>(size));
+		stream.seekg(0);
+		if (!stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) && !stream.eof())
+		{
+			error = "Unable to read file";
+			return false;
+		}
+		buffer.resize(static_cast<size_t>(stream.gcount())); // The file may have been truncated since it was opened.
+		return true;
+	}
+
+	std::span<const std::byte> asBytes(const std::string& buffer) noexcept
+	{
+		return { reinterpret_cast<const std::byte*>(buffer.data()), buffer.size() };
+	}
+
+	std::unique_ptr<seir::synth::Composition> parseText(const std::string& text, std::string& error)
+	{
+		try
+		{
+			if (auto composition = seir::synth::Composition::create(text.c_str()))
+				return composition;
+		}
+		catch (const std::runtime_error& e)
+		{
+			error = e.what();
+			return {};
+		}
+		error = "Invalid composition";
+		return {};
+	}
+
+	uint64_t compositionKey(const seir::synth::Composition& composition)
+	{
+		const auto buffer = seir::synth::serialize(composition);
+		return aulos::Hash{}.add(buffer.data(), buffer.size()).value();
+	}
+}
+
+namespace aulos
+{
+	std::optional<float> GainCache::find(const seir::synth::Composition& composition) const
+	{
+		if (!_amplitude || ::compositionKey(composition) != _key)
+			return {};
+		return _amplitude;
+	}
+
+	std::unique_ptr<seir::synth::Composition> GainCache::pack(seir::synth::CompositionData& data)
+	{
+		data._gainDivisor = 1;
+		auto composition = data.pack();
+		if (!composition)
+			return {};
+		if (const auto key = ::compositionKey(*composition); !_amplitude || key != _key)
+		{
+			_key = key;
+			_amplitude = *measureAmplitude(*composition);
+		}
+		data._gainDivisor = *_amplitude;
+		return data.pack();
+	}
+
+	void GainCache::store(const seir::synth::Composition& composition, float amplitude)
+	{
+		_key = ::compositionKey(composition);
+		_amplitude = amplitude;
+	}
+
+	std::shared_ptr<seir::synth::CompositionData> copyCompositionData(const seir::synth::CompositionData& data)
+	{
+		auto result = std::make_shared<seir::synth::CompositionData>();
+		result->_speed = data._speed;
+		result->_loopOffset = data._loopOffset;
+		result->_loopLength = data._loopLength;
+		result->_gainDivisor = data._gainDivisor;
+		result->_title = data._title;
+		result->_author = data._author;
+		result->_parts.reserve(data._parts.size());
+		std::unordered_map<const seir::synth::SequenceData*, std::shared_ptr<seir::synth::SequenceData>> sequences;
+		for (const auto& partData : data._parts)
+		{
+			const auto& part = result->_parts.emplace_back(std::make_shared<seir::synth::PartData>(std::make_shared<seir::synth::VoiceData>(*partData->_voice)));
+			part->_voiceName = partData->_voiceName;
+			part->_tracks.reserve(partData->_tracks.size());
+			for (const auto& trackData : partData->_tracks)
+			{
+				// Fragments refer to the track's sequences, and the copies must too.
+				const auto& track = part->_tracks.emplace_back(std::make_shared<seir::synth::TrackData>(std::make_shared<seir::synth::TrackProperties>(*trackData->_properties)));
+				track->_sequences.reserve(trackData->_sequences.size());
+				sequences.clear();
+				for (const auto& sequenceData : trackData->_sequences)
+					sequences.emplace(sequenceData.get(), track->_sequences.emplace_back(std::make_shared<seir::synth::SequenceData>(*sequenceData)));
+				for (const auto& fragment : trackData->_fragments)
+				{
+					auto& sequence = sequences[fragment.second.get()];
+					if (!sequence)
+						sequence = std::make_shared<seir::synth::SequenceData>(*fragment.second);
+					track->_fragments.emplace_hint(track->_fragments.end(), fragment.first, sequence);
+				}
+			}
+		}
+		return result;
+	}
+
+	std::unique_ptr<seir::synth::Composition> loadComposition(const std::filesystem::path& path, std::string& error)
+	{
+		std::string buffer;
+		if (!::readFile(path, buffer, error))
+			return {};
+		if (isBinaryComposition(::asBytes(buffer)))
+		{
+			const auto data = loadBinaryComposition(::asBytes(buffer), error);
+			return data ? data->pack() : nullptr;
+		}
+		return ::parseText(buffer, error);
+	}
+
+	std::shared_ptr<seir::synth::CompositionData> loadCompositionData(const std::filesystem::path& path, std::string& error, LoadTimings* timings)
+	{
+		LoadTimings localTimings;
+		if (!timings)
+			timings = &localTimings;
+		auto start = Clock::now();
+		const auto finishPhase = [&start](std::chrono::nanoseconds& phase) {
+			const auto now = Clock::now();
+			phase = now - start;
+			start = now;
+		};
+
+		std::string buffer;
+		const auto isRead = ::readFile(path, buffer, error);
+		finishPhase(timings->_read);
+		if (!isRead)
+			return {};
+		if (isBinaryComposition(::asBytes(buffer)))
+		{
+			auto data = loadBinaryComposition(::asBytes(buffer), error);
+			finishPhase(timings->_parse);
+			return data;
+		}
+		const auto packed = ::parseText(buffer, error);
+		buffer = {}; // The text is released before the conversion, so that no more than two copies exist at a time.
+		finishPhase(timings->_parse);
+		if (!packed)
+			return {};
+		auto data = std::make_shared<seir::synth::CompositionData>(*packed);
+		finishPhase(timings->_convert);
+		return data;
+	}
+
+	std::optional<float> measureAmplitude(const seir::synth::Composition& composition, const std::function<bool(size_t)>& progressCallback)
+	{
+		// TODO: Implement gain calculation with looping.
+		const auto renderer = seir::synth::Renderer::create(composition, { seir::synth::Renderer::kMaxSamplingRate, seir::synth::ChannelLayout::Mono }, false);
+		assert(renderer);
+		float minimum = 0.f;
+		float maximum = 0.f;
+		size_t totalFrames = 0;
+		for (std::array<float, kBufferSize / sizeof(float)> buffer;;)
+		{
+			const auto framesRendered = renderer->render(buffer.data(), buffer.size());
+			if (!framesRendered)
+				break;
+			const auto minmax = std::minmax_element(buffer.cbegin(), buffer.cbegin() + framesRendered);
+			minimum = std::min(minimum, *minmax.first);
+			maximum = std::max(maximum, *minmax.second);
+			totalFrames += framesRendered;
+			if (progressCallback && !progressCallback(totalFrames))
+				return {};
+		}
+		return std::max(-minimum, maximum);
+	}
+
+	std::unique_ptr<seir::synth::Composition> normalizeComposition(const seir::synth::Composition& composition, float amplitude)
+	{
+		seir::synth::CompositionData data{ composition };
+		data._gainDivisor = amplitude;
+		return data.pack();
+	}
+
+	std::unique_ptr<seir::synth::Composition> packComposition(seir::synth::CompositionData& data)
+	{
+		data._gainDivisor = 1;
+		auto composition = data.pack();
+		if (!composition)
+			return {};
+		data._gainDivisor = *measureAmplitude(*composition);
+		return data.pack();
+	}
+
+	uint64_t renderKey(const seir::synth::Composition& composition, const seir::synth::AudioFormat& format)
+	{
+		const auto buffer = seir::synth::serialize(composition);
+		return Hash{}.add(buffer.data(), buffer.size()).add(format.samplingRate()).add(format.channelLayout()).value();
+	}
+
+	bool saveComposition(const seir::synth::Composition& composition, Sink& sink)
+	{
+		const auto buffer = seir::synth::serialize(composition);
+		return sink.write(buffer.data(), buffer.size());
+	}
+}
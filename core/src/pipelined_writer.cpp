@@ -0,0 +1,86 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/pipelined_writer.hpp>
+
+#include <cassert>
+
+namespace aulos
+{
+	PipelinedWriter::PipelinedWriter(Sink&& sink, size_t blockSize, size_t blockCount)
+		: _sink{ std::move(sink) }
+		, _blockSize{ blockSize }
+	{
+		assert(_blockSize > 0);
+		assert(blockCount > 0);
+		_storage.reserve(blockCount);
+		_freeBlocks.reserve(blockCount);
+		for (size_t i = 0; i < blockCount; ++i)
+			_freeBlocks.emplace_back(_storage.emplace_back(std::make_unique<std::byte[]>(_blockSize)).get());
+		_thread = std::thread{ [this] { run(); } };
+	}
+
+	PipelinedWriter::~PipelinedWriter() noexcept
+	{
+		finish();
+	}
+
+	std::byte* PipelinedWriter::acquire()
+	{
+		std::unique_lock lock{ _mutex };
+		_freeCondition.wait(lock, [this] { return !_freeBlocks.empty(); });
+		const auto block = _freeBlocks.back();
+		_freeBlocks.pop_back();
+		return block;
+	}
+
+	bool PipelinedWriter::finish()
+	{
+		if (_thread.joinable())
+		{
+			{
+				std::lock_guard lock{ _mutex };
+				_finishing = true;
+			}
+			_queueCondition.notify_one();
+			_thread.join();
+		}
+		return !_failed;
+	}
+
+	bool PipelinedWriter::submit(std::byte* block, size_t size)
+	{
+		assert(size <= _blockSize);
+		{
+			std::lock_guard lock{ _mutex };
+			assert(!_finishing);
+			_queue.push_back({ block, size });
+		}
+		_queueCondition.notify_one();
+		std::lock_guard lock{ _mutex };
+		return !_failed;
+	}
+
+	void PipelinedWriter::run()
+	{
+		std::unique_lock lock{ _mutex };
+		for (;;)
+		{
+			_queueCondition.wait(lock, [this] { return !_queue.empty() || _finishing; });
+			if (_queue.empty())
+				break;
+			const auto block = _queue.front();
+			_queue.pop_front();
+			const auto canWrite = !_failed;
+			lock.unlock();
+			// After a failure the remaining blocks are just recycled so that the producer never blocks forever.
+			const auto written = canWrite && _sink(block._data, block._size);
+			lock.lock();
+			if (!written)
+				_failed = true;
+			_freeBlocks.emplace_back(block._data);
+			_freeCondition.notify_one();
+		}
+	}
+}
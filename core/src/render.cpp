@@ -0,0 +1,76 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/render.hpp>
+
+#include <aulos_core/sink.hpp>
+#include <aulos_core/wav.hpp>
+
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+	bool writeWavHeader(aulos::Sink& sink, const seir::synth::AudioFormat& format, size_t dataSize)
+	{
+		const auto header = aulos::makeWavHeader(format, dataSize);
+		return sink.write(header.data(), header.size());
+	}
+}
+
+namespace aulos
+{
+	RenderStatus render(const seir::synth::Composition& composition, const seir::synth::AudioFormat& format, Sink& sink, const RenderOptions& options)
+	{
+		const auto renderer = seir::synth::Renderer::create(composition, format, false);
+		if (!renderer)
+			return RenderStatus::Failed;
+
+		const auto isWav = options._outputFormat == OutputFormat::Wav;
+		if (isWav)
+		{
+			// A streamed WAV file can't be patched afterwards, so it claims as much data as the format allows.
+			constexpr size_t kMaxDataSize = std::numeric_limits<uint32_t>::max() - kWavHeaderSize;
+			if (!::writeWavHeader(sink, format, sink.isSeekable() ? 0 : kMaxDataSize))
+				return RenderStatus::Failed;
+		}
+
+		const auto blockFrames = std::max<size_t>(options._blockSize / format.bytesPerFrame(), 1);
+		size_t dataSize = 0;
+		auto status = RenderStatus::Completed;
+		{
+			PipelinedWriter writer{ [&sink](const std::byte* data, size_t size) { return sink.write(data, size); }, blockFrames * format.bytesPerFrame() };
+			for (;;)
+			{
+				const auto block = writer.acquire();
+				const auto renderedBytes = renderer->render(reinterpret_cast<float*>(block), blockFrames) * format.bytesPerFrame();
+				if (!renderedBytes)
+					break;
+				if (!writer.submit(block, renderedBytes))
+				{
+					status = RenderStatus::Failed;
+					break;
+				}
+				dataSize += renderedBytes;
+				if (options._progressCallback && !options._progressCallback(dataSize / format.bytesPerFrame()))
+				{
+					status = RenderStatus::Cancelled;
+					break;
+				}
+			}
+			if (!writer.finish() && status == RenderStatus::Completed)
+				status = RenderStatus::Failed;
+		}
+		if (status != RenderStatus::Completed)
+			return status;
+
+		if (isWav && sink.isSeekable() && (!sink.seek(0) || !::writeWavHeader(sink, format, dataSize)))
+			return RenderStatus::Failed;
+		return RenderStatus::Completed;
+	}
+}
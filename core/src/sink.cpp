@@ -0,0 +1,73 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/sink.hpp>
+
+#include <cstring>
+#include <utility>
+
+namespace aulos
+{
+	FileSink::FileSink(const std::filesystem::path& path)
+		: _path{ path }
+		, _temporaryPath{ std::filesystem::path{ path } += ".part" }
+		, _stream{ _temporaryPath, std::ios::binary | std::ios::trunc }
+	{
+	}
+
+	FileSink::~FileSink() noexcept
+	{
+		if (_stream.is_open())
+		{
+			_stream.close();
+			std::error_code error;
+			std::filesystem::remove(_temporaryPath, error);
+		}
+	}
+
+	bool FileSink::commit()
+	{
+		if (!_stream.is_open())
+			return false;
+		_stream.close();
+		std::error_code error;
+		if (_stream && (std::filesystem::rename(_temporaryPath, _path, error), !error))
+			return true;
+		std::filesystem::remove(_temporaryPath, error);
+		return false;
+	}
+
+	bool FileSink::seek(uint64_t offset)
+	{
+		return static_cast<bool>(_stream.seekp(static_cast<std::streamoff>(offset)));
+	}
+
+	bool FileSink::write(const void* data, size_t size)
+	{
+		return static_cast<bool>(_stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)));
+	}
+
+	std::vector<std::byte> MemorySink::release() noexcept
+	{
+		_position = 0;
+		return std::exchange(_data, {});
+	}
+
+	bool MemorySink::seek(uint64_t offset)
+	{
+		if (offset > _data.size())
+			return false;
+		_position = static_cast<size_t>(offset);
+		return true;
+	}
+
+	bool MemorySink::write(const void* data, size_t size)
+	{
+		if (const auto end = _position + size; end > _data.size())
+			_data.resize(end);
+		std::memcpy(_data.data() + _position, data, size);
+		_position += size;
+		return true;
+	}
+}
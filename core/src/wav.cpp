@@ -0,0 +1,68 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <aulos_core/wav.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	class HeaderWriter
+	{
+	public:
+		explicit HeaderWriter(std::array<std::byte, aulos::kWavHeaderSize>& header) noexcept
+			: _header{ header } {}
+
+		size_t offset() const noexcept { return _offset; }
+
+		void write(const char* tag) noexcept
+		{
+			assert(std::strlen(tag) == 4);
+			for (size_t i = 0; i < 4; ++i)
+				_header[_offset++] = static_cast<std::byte>(tag[i]);
+		}
+
+		template <typename T>
+		void write(T value) noexcept
+		{
+			for (size_t i = 0; i < sizeof value; ++i)
+				_header[_offset++] = static_cast<std::byte>((value >> (8 * i)) & 0xff);
+		}
+
+	private:
+		std::array<std::byte, aulos::kWavHeaderSize>& _header;
+		size_t _offset = 0;
+	};
+}
+
+namespace aulos
+{
+	std::array<std::byte, kWavHeaderSize> makeWavHeader(const seir::synth::AudioFormat& format, size_t dataSize)
+	{
+		constexpr size_t chunkHeaderSize = 8;
+		constexpr size_t fmtChunkSize = 16;
+		static_assert(kWavHeaderSize == chunkHeaderSize + 4 + chunkHeaderSize + fmtChunkSize + chunkHeaderSize);
+
+		std::array<std::byte, kWavHeaderSize> header;
+		HeaderWriter writer{ header };
+		writer.write("RIFF");
+		writer.write(static_cast<uint32_t>(kWavHeaderSize + dataSize));
+		assert(writer.offset() == chunkHeaderSize);
+		writer.write("WAVE");
+		writer.write("fmt ");
+		writer.write(static_cast<uint32_t>(fmtChunkSize));
+		writer.write(uint16_t{ 3 }); // Data format: IEEE float PCM samples.
+		writer.write(static_cast<uint16_t>(format.channelCount()));
+		writer.write(static_cast<uint32_t>(format.samplingRate()));
+		writer.write(static_cast<uint32_t>(format.samplingRate() * format.bytesPerFrame()));
+		writer.write(static_cast<uint16_t>(format.bytesPerFrame()));
+		writer.write(static_cast<uint16_t>(sizeof(float) * 8));
+		writer.write("data");
+		writer.write(static_cast<uint32_t>(dataSize));
+		assert(writer.offset() == kWavHeaderSize);
+		return header;
+	}
+}
@@ -0,0 +1,57 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "client.hpp"
+
+#include "protocol.hpp"
+#include "socket.hpp"
+
+#include <fstream>
+#include <iterator>
+
+bool renderOnServer(const std::string& socketPath, const std::filesystem::path& input, const std::filesystem::path& output, const seir::synth::AudioFormat& format, aulos::OutputFormat outputFormat, std::string& error)
+{
+	std::ifstream stream{ input, std::ios::binary };
+	if (!stream)
+	{
+		error = "Unable to open file";
+		return false;
+	}
+	const std::string text{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+	if (stream.bad())
+	{
+		error = "Unable to read file";
+		return false;
+	}
+
+	auto socket = Socket::connect(socketPath);
+	if (!socket.isOpen())
+	{
+		error = "Unable to connect to " + socketPath;
+		return false;
+	}
+	std::string header;
+	header += "rate " + std::to_string(format.samplingRate()) + "\n";
+	header += "channels " + std::string{ protocol::channelLayoutName(format.channelLayout()) } + "\n";
+	header += "format " + std::string{ protocol::outputFormatName(outputFormat) } + "\n";
+	header += "output " + std::filesystem::absolute(output).string() + "\n";
+	header += "size " + std::to_string(text.size()) + "\n\n";
+	std::string response;
+	if (!socket.write(header) || !socket.write(text) || !socket.readLine(response))
+	{
+		error = "Connection to the render daemon was lost";
+		return false;
+	}
+	if (response.starts_with("error "))
+	{
+		error = response.substr(6);
+		return false;
+	}
+	if (response != "ok 0")
+	{
+		error = "Unexpected response from the render daemon";
+		return false;
+	}
+	return true;
+}
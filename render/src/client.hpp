@@ -0,0 +1,16 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/render.hpp>
+
+#include <seir_synth/format.hpp>
+
+#include <filesystem>
+#include <string>
+
+// Renders the input file using the render daemon listening on the specified socket.
+// The daemon writes the output file itself, so the output path is made absolute.
+bool renderOnServer(const std::string& socketPath, const std::filesystem::path& input, const std::filesystem::path& output, const seir::synth::AudioFormat&, aulos::OutputFormat, std::string& error);
@@ -0,0 +1,128 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "protocol.hpp"
+#include "server.hpp"
+#include "socket.hpp"
+
+#include <aulos_config.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+namespace
+{
+	constexpr size_t kMegabyte = size_t{ 1 } << 20;
+
+	struct Options
+	{
+		std::string _socketPath = protocol::defaultSocketPath();
+		size_t _audioCacheSize = 1024 * kMegabyte;
+		size_t _compositionCacheSize = 64 * kMegabyte;
+	};
+
+	std::string socketPath;
+
+	void printUsage()
+	{
+		std::cout << "Usage: aulos_renderd [OPTIONS]\n"
+					 "Serve Aulos composition render requests from a local socket.\n"
+					 "\n"
+					 "Options:\n"
+					 "  -a, --audio-cache MB          Memory for rendered audio (default: 1024)\n"
+					 "  -c, --composition-cache MB    Memory for packed compositions (default: 64)\n"
+					 "  -h, --help                    Print this help and exit\n"
+					 "  -s, --socket PATH             Socket path (default: $XDG_RUNTIME_DIR/aulos_renderd.socket)\n"
+					 "      --version                 Print version and exit\n";
+	}
+
+	// Returns an empty optional if the program should exit with the specified code.
+	std::optional<Options> parseOptions(int argc, char** argv, int& exitCode)
+	{
+		Options options;
+		exitCode = 1;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view arg{ argv[i] };
+			if (arg == "-h" || arg == "--help")
+			{
+				::printUsage();
+				exitCode = 0;
+				return {};
+			}
+			if (arg == "--version")
+			{
+				std::cout << "aulos_renderd " AULOS_VERSION "\n";
+				exitCode = 0;
+				return {};
+			}
+			if (i + 1 == argc)
+			{
+				std::cerr << "aulos_renderd: missing value for " << arg << "\n";
+				return {};
+			}
+			const std::string_view value{ argv[++i] };
+			if (arg == "-a" || arg == "--audio-cache" || arg == "-c" || arg == "--composition-cache")
+			{
+				const auto megabytes = protocol::parseNumber<size_t>(value);
+				if (!megabytes)
+				{
+					std::cerr << "aulos_renderd: invalid cache size: " << value << "\n";
+					return {};
+				}
+				(arg == "-a" || arg == "--audio-cache" ? options._audioCacheSize : options._compositionCacheSize) = *megabytes * kMegabyte;
+			}
+			else if (arg == "-s" || arg == "--socket")
+				options._socketPath = value;
+			else
+			{
+				std::cerr << "aulos_renderd: unknown option: " << arg << "\n";
+				return {};
+			}
+		}
+		return options;
+	}
+
+	void stop(int)
+	{
+		::unlink(socketPath.c_str());
+		std::_Exit(0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int exitCode = 0;
+	const auto options = ::parseOptions(argc, argv, exitCode);
+	if (!options)
+		return exitCode;
+
+	auto listener = Socket::listen(options->_socketPath);
+	if (!listener.isOpen())
+	{
+		std::cerr << "aulos_renderd: unable to listen on " << options->_socketPath << "\n";
+		return 1;
+	}
+	::socketPath = options->_socketPath;
+	std::signal(SIGINT, ::stop);
+	std::signal(SIGTERM, ::stop);
+	std::signal(SIGPIPE, SIG_IGN); // Clients may disconnect before receiving the response.
+	std::cout << "aulos_renderd: listening on " << options->_socketPath << std::endl;
+
+	Server server{ options->_compositionCacheSize, options->_audioCacheSize };
+	for (;;)
+	{
+		auto connection = listener.accept();
+		if (!connection.isOpen())
+			continue;
+		std::thread{ [&server, connection = std::move(connection)]() mutable { server.serve(connection); } }.detach();
+	}
+}
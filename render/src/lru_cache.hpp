@@ -0,0 +1,69 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+// Keeps the most recently used values within the specified total cost.
+// Values are shared, so evicting a value doesn't invalidate it for those who are still using it.
+template <typename Value>
+class LruCache
+{
+public:
+	explicit LruCache(size_t capacity) noexcept
+		: _capacity{ capacity } {}
+
+	constexpr size_t cost() const noexcept { return _cost; }
+
+	std::shared_ptr<const Value> find(uint64_t key)
+	{
+		const auto i = _index.find(key);
+		if (i == _index.end())
+			return {};
+		_entries.splice(_entries.begin(), _entries, i->second);
+		return i->second->_value;
+	}
+
+	void insert(uint64_t key, const std::shared_ptr<const Value>& value, size_t cost)
+	{
+		if (const auto i = _index.find(key); i != _index.end())
+		{
+			_cost -= i->second->_cost;
+			_entries.erase(i->second);
+			_index.erase(i);
+		}
+		if (cost > _capacity)
+			return;
+		while (_cost + cost > _capacity)
+		{
+			const auto& entry = _entries.back();
+			_cost -= entry._cost;
+			_index.erase(entry._key);
+			_entries.pop_back();
+		}
+		_entries.push_front({ key, value, cost });
+		_index.emplace(key, _entries.begin());
+		_cost += cost;
+	}
+
+	constexpr size_t size() const noexcept { return _index.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t _key;
+		std::shared_ptr<const Value> _value;
+		size_t _cost;
+	};
+
+	const size_t _capacity;
+	size_t _cost = 0;
+	std::list<Entry> _entries;
+	std::unordered_map<uint64_t, typename std::list<Entry>::iterator> _index;
+};
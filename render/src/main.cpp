@@ -0,0 +1,314 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#if AULOS_RENDER_CLIENT
+#	include "client.hpp"
+#endif
+
+#include <aulos_core/binary.hpp>
+#include <aulos_core/composition.hpp>
+#include <aulos_core/render.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <aulos_config.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	enum class CompositionFormat
+	{
+		Text,
+		Binary,
+	};
+
+	struct Options
+	{
+		std::vector<std::filesystem::path> _inputs;
+		std::filesystem::path _output;
+		std::filesystem::path _outputDirectory;
+		aulos::OutputFormat _outputFormat = aulos::OutputFormat::Wav;
+		std::optional<CompositionFormat> _compositionFormat; // Compositions are converted instead of being rendered.
+		unsigned _samplingRate = 48'000;
+		seir::synth::ChannelLayout _channelLayout = seir::synth::ChannelLayout::Stereo;
+		size_t _jobs = 1;
+		size_t _blockSize = aulos::PipelinedWriter::kDefaultBlockSize;
+		std::string _server;
+	};
+
+	void printUsage()
+	{
+		std::cout << "Usage: aulos_render [OPTIONS] INPUT...\n"
+					 "Render Aulos compositions into audio files.\n"
+					 "\n"
+					 "Options:\n"
+					 "  -b, --block-size BYTES    Size of output write blocks (default: 1048576)\n"
+					 "  -c, --channels LAYOUT     'mono' or 'stereo' (default: stereo)\n"
+					 "  -d, --output-dir DIR      Directory for output files (default: next to inputs)\n"
+					 "  -f, --format FORMAT       'wav' or 'raw' (32-bit float PCM) to render,\n"
+					 "                            'aulos' (text) or 'aulosb' (binary) to convert (default: wav)\n"
+					 "  -h, --help                Print this help and exit\n"
+					 "  -j, --jobs N              Render N files concurrently (0 for all cores, default: 1)\n"
+					 "  -o, --output FILE         Output file (for a single input)\n"
+					 "  -r, --rate HZ             Sampling rate (default: 48000)\n"
+#if AULOS_RENDER_CLIENT
+					 "  -s, --server SOCKET       Render using aulos_renderd listening on SOCKET\n"
+#endif
+					 "      --version             Print version and exit\n";
+	}
+
+	template <typename T>
+	std::optional<T> parseNumber(std::string_view text)
+	{
+		T value{};
+		const auto end = text.data() + text.size();
+		if (const auto result = std::from_chars(text.data(), end, value); result.ec != std::errc{} || result.ptr != end)
+			return {};
+		return value;
+	}
+
+	// Returns an empty optional if the program should exit with the specified code.
+	std::optional<Options> parseOptions(int argc, char** argv, int& exitCode)
+	{
+		Options options;
+		exitCode = 1;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string_view arg{ argv[i] };
+			if (arg.empty() || arg[0] != '-' || arg == "-")
+			{
+				options._inputs.emplace_back(std::filesystem::path{ arg });
+				continue;
+			}
+			if (arg == "-h" || arg == "--help")
+			{
+				::printUsage();
+				exitCode = 0;
+				return {};
+			}
+			if (arg == "--version")
+			{
+				std::cout << "aulos_render " AULOS_VERSION "\n";
+				exitCode = 0;
+				return {};
+			}
+			if (i + 1 == argc)
+			{
+				std::cerr << "aulos_render: missing value for " << arg << "\n";
+				return {};
+			}
+			const std::string_view value{ argv[++i] };
+			if (arg == "-b" || arg == "--block-size")
+			{
+				const auto blockSize = ::parseNumber<size_t>(value);
+				if (!blockSize || !*blockSize)
+				{
+					std::cerr << "aulos_render: invalid block size: " << value << "\n";
+					return {};
+				}
+				options._blockSize = *blockSize;
+			}
+			else if (arg == "-c" || arg == "--channels")
+			{
+				if (value == "mono")
+					options._channelLayout = seir::synth::ChannelLayout::Mono;
+				else if (value == "stereo")
+					options._channelLayout = seir::synth::ChannelLayout::Stereo;
+				else
+				{
+					std::cerr << "aulos_render: invalid channel layout: " << value << "\n";
+					return {};
+				}
+			}
+			else if (arg == "-d" || arg == "--output-dir")
+				options._outputDirectory = std::filesystem::path{ value };
+			else if (arg == "-f" || arg == "--format")
+			{
+				options._compositionFormat.reset();
+				if (value == "wav")
+					options._outputFormat = aulos::OutputFormat::Wav;
+				else if (value == "raw")
+					options._outputFormat = aulos::OutputFormat::Raw;
+				else if (value == "aulos")
+					options._compositionFormat = CompositionFormat::Text;
+				else if (value == "aulosb")
+					options._compositionFormat = CompositionFormat::Binary;
+				else
+				{
+					std::cerr << "aulos_render: invalid output format: " << value << "\n";
+					return {};
+				}
+			}
+			else if (arg == "-j" || arg == "--jobs")
+			{
+				const auto jobs = ::parseNumber<size_t>(value);
+				if (!jobs)
+				{
+					std::cerr << "aulos_render: invalid job count: " << value << "\n";
+					return {};
+				}
+				options._jobs = *jobs ? *jobs : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			}
+			else if (arg == "-o" || arg == "--output")
+				options._output = std::filesystem::path{ value };
+			else if (arg == "-r" || arg == "--rate")
+			{
+				const auto samplingRate = ::parseNumber<unsigned>(value);
+				if (!samplingRate || !*samplingRate || *samplingRate > seir::synth::Renderer::kMaxSamplingRate)
+				{
+					std::cerr << "aulos_render: invalid sampling rate: " << value << "\n";
+					return {};
+				}
+				options._samplingRate = *samplingRate;
+			}
+#if AULOS_RENDER_CLIENT
+			else if (arg == "-s" || arg == "--server")
+				options._server = value;
+#endif
+			else
+			{
+				std::cerr << "aulos_render: unknown option: " << arg << "\n";
+				return {};
+			}
+		}
+		if (options._inputs.empty())
+		{
+			std::cerr << "aulos_render: no input files\n";
+			return {};
+		}
+		if (!options._output.empty() && options._inputs.size() > 1)
+		{
+			std::cerr << "aulos_render: --output requires a single input file\n";
+			return {};
+		}
+		return options;
+	}
+
+	std::filesystem::path makeOutputPath(const Options& options, const std::filesystem::path& input)
+	{
+		if (!options._output.empty())
+			return options._output;
+		auto result = options._outputDirectory.empty() ? input : options._outputDirectory / input.filename();
+		if (options._compositionFormat)
+			result.replace_extension(*options._compositionFormat == CompositionFormat::Binary ? ".aulosb" : ".aulos");
+		else
+			result.replace_extension(options._outputFormat == aulos::OutputFormat::Wav ? ".wav" : ".raw");
+		return result;
+	}
+
+	bool convertFile(CompositionFormat format, const std::filesystem::path& input, const std::filesystem::path& output, std::string& error)
+	{
+		const auto composition = aulos::loadCompositionData(input, error);
+		if (!composition)
+			return false;
+		aulos::FileSink sink{ output };
+		if (!sink.isOpen())
+		{
+			error = "Unable to create output file";
+			return false;
+		}
+		const auto saved = format == CompositionFormat::Binary
+			? aulos::saveBinaryComposition(*composition, sink)
+			: aulos::saveComposition(*composition->pack(), sink);
+		if (!saved || !sink.commit())
+		{
+			error = "Unable to write output file";
+			return false;
+		}
+		return true;
+	}
+
+	bool renderFile(const Options& options, const std::filesystem::path& input, const std::filesystem::path& output, std::string& error)
+	{
+		if (options._compositionFormat)
+			return ::convertFile(*options._compositionFormat, input, output, error);
+#if AULOS_RENDER_CLIENT
+		if (!options._server.empty())
+			return ::renderOnServer(options._server, input, output, { options._samplingRate, options._channelLayout }, options._outputFormat, error);
+#endif
+		const auto packed = aulos::loadComposition(input, error);
+		if (!packed)
+			return false;
+		seir::synth::CompositionData data{ *packed };
+		const auto composition = aulos::packComposition(data);
+		if (!composition)
+		{
+			error = "Unable to pack composition";
+			return false;
+		}
+
+		aulos::FileSink sink{ output };
+		if (!sink.isOpen())
+		{
+			error = "Unable to create output file";
+			return false;
+		}
+		aulos::RenderOptions renderOptions;
+		renderOptions._outputFormat = options._outputFormat;
+		renderOptions._blockSize = options._blockSize;
+		if (aulos::render(*composition, { options._samplingRate, options._channelLayout }, sink, renderOptions) != aulos::RenderStatus::Completed || !sink.commit())
+		{
+			error = "Unable to write output file";
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int exitCode = 0;
+	const auto options = ::parseOptions(argc, argv, exitCode);
+	if (!options)
+		return exitCode;
+
+	std::atomic<size_t> nextInput{ 0 };
+	std::atomic<bool> failed{ false };
+	std::mutex outputMutex;
+	const auto renderInputs = [&] {
+		for (;;)
+		{
+			const auto index = nextInput++;
+			if (index >= options->_inputs.size())
+				break;
+			const auto& input = options->_inputs[index];
+			const auto output = ::makeOutputPath(*options, input);
+			std::string error;
+			const auto success = ::renderFile(*options, input, output, error);
+			std::lock_guard lock{ outputMutex };
+			if (success)
+				std::cout << input.string() << " -> " << output.string() << "\n";
+			else
+			{
+				std::cerr << input.string() << ": " << error << "\n";
+				failed = true;
+			}
+		}
+	};
+
+	// Every job renders whole files, so the files are distributed across the threads.
+	const auto jobCount = std::min(options->_jobs, options->_inputs.size());
+	std::vector<std::thread> threads;
+	threads.reserve(jobCount - 1);
+	for (size_t i = 1; i < jobCount; ++i)
+		threads.emplace_back(renderInputs);
+	renderInputs();
+	for (auto& thread : threads)
+		thread.join();
+	return failed ? 1 : 0;
+}
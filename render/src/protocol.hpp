@@ -0,0 +1,77 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/render.hpp>
+
+#include <seir_synth/format.hpp>
+
+#include <charconv>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <unistd.h>
+
+// The render daemon serves one request per connection.
+//
+// The request consists of header lines terminated by an empty line, followed by the composition (text or binary):
+//   rate <sampling rate>
+//   channels mono|stereo
+//   format wav|raw
+//   output <absolute path>   (optional, the result is streamed back if there is no output path)
+//   size <composition size>
+//
+// The response is either an "ok <size>" line followed by <size> bytes of audio data
+// (the size is zero if the result was written to the output path), or an "error <message>" line.
+namespace protocol
+{
+	// Returns the socket path used if none is specified explicitly.
+	inline std::string defaultSocketPath()
+	{
+		if (const auto runtimeDirectory = std::getenv("XDG_RUNTIME_DIR"); runtimeDirectory && *runtimeDirectory)
+			return std::string{ runtimeDirectory } + "/aulos_renderd.socket";
+		return "/tmp/aulos_renderd-" + std::to_string(::getuid()) + ".socket";
+	}
+
+	constexpr std::string_view channelLayoutName(seir::synth::ChannelLayout channelLayout) noexcept
+	{
+		return channelLayout == seir::synth::ChannelLayout::Mono ? "mono" : "stereo";
+	}
+
+	constexpr std::string_view outputFormatName(aulos::OutputFormat outputFormat) noexcept
+	{
+		return outputFormat == aulos::OutputFormat::Wav ? "wav" : "raw";
+	}
+
+	inline std::optional<seir::synth::ChannelLayout> parseChannelLayout(std::string_view text) noexcept
+	{
+		if (text == "mono")
+			return seir::synth::ChannelLayout::Mono;
+		if (text == "stereo")
+			return seir::synth::ChannelLayout::Stereo;
+		return {};
+	}
+
+	template <typename T>
+	std::optional<T> parseNumber(std::string_view text) noexcept
+	{
+		T value{};
+		const auto end = text.data() + text.size();
+		if (const auto result = std::from_chars(text.data(), end, value); result.ec != std::errc{} || result.ptr != end)
+			return {};
+		return value;
+	}
+
+	inline std::optional<aulos::OutputFormat> parseOutputFormat(std::string_view text) noexcept
+	{
+		if (text == "wav")
+			return aulos::OutputFormat::Wav;
+		if (text == "raw")
+			return aulos::OutputFormat::Raw;
+		return {};
+	}
+}
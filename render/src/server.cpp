@@ -0,0 +1,219 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "server.hpp"
+
+#include "protocol.hpp"
+#include "socket.hpp"
+
+#include <aulos_core/binary.hpp>
+#include <aulos_core/composition.hpp>
+#include <aulos_core/hash.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <span>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t kMaxTextSize = size_t{ 64 } << 20;
+
+	struct Request
+	{
+		seir::synth::AudioFormat _format;
+		aulos::OutputFormat _outputFormat = aulos::OutputFormat::Wav;
+		std::string _output;
+		std::string _text;
+	};
+
+	bool readRequest(Socket& socket, Request& request, std::string& error)
+	{
+		unsigned samplingRate = 0;
+		auto channelLayout = seir::synth::ChannelLayout::Stereo;
+		std::optional<size_t> textSize;
+		for (std::string line;;)
+		{
+			if (!socket.readLine(line))
+			{
+				error = "Incomplete request";
+				return false;
+			}
+			if (line.empty())
+				break;
+			const auto space = line.find(' ');
+			const std::string_view key{ line.data(), space == std::string::npos ? line.size() : space };
+			const auto value = space == std::string::npos ? std::string_view{} : std::string_view{ line }.substr(space + 1);
+			if (key == "rate")
+			{
+				const auto rate = protocol::parseNumber<unsigned>(value);
+				if (!rate || !*rate || *rate > seir::synth::Renderer::kMaxSamplingRate)
+				{
+					error = "Invalid sampling rate";
+					return false;
+				}
+				samplingRate = *rate;
+			}
+			else if (key == "channels")
+			{
+				const auto layout = protocol::parseChannelLayout(value);
+				if (!layout)
+				{
+					error = "Invalid channel layout";
+					return false;
+				}
+				channelLayout = *layout;
+			}
+			else if (key == "format")
+			{
+				const auto format = protocol::parseOutputFormat(value);
+				if (!format)
+				{
+					error = "Invalid output format";
+					return false;
+				}
+				request._outputFormat = *format;
+			}
+			else if (key == "output")
+				request._output = value;
+			else if (key == "size")
+			{
+				textSize = protocol::parseNumber<size_t>(value);
+				if (!textSize || *textSize > kMaxTextSize)
+				{
+					error = "Invalid composition size";
+					return false;
+				}
+			}
+			else
+			{
+				error = "Unknown request field: " + std::string{ key };
+				return false;
+			}
+		}
+		if (!samplingRate || !textSize)
+		{
+			error = "Incomplete request";
+			return false;
+		}
+		request._format = { samplingRate, channelLayout };
+		request._text.resize(*textSize);
+		if (!socket.read(request._text.data(), request._text.size()))
+		{
+			error = "Incomplete request";
+			return false;
+		}
+		return true;
+	}
+}
+
+Server::Server(size_t compositionCacheSize, size_t audioCacheSize) noexcept
+	: _compositions{ compositionCacheSize }
+	, _audio{ audioCacheSize }
+{
+}
+
+void Server::serve(Socket& socket)
+{
+	Request request;
+	std::string error;
+	if (!::readRequest(socket, request, error))
+	{
+		socket.write("error " + error + "\n");
+		return;
+	}
+	const auto data = audio(request._text, request._format, request._outputFormat, error);
+	if (!data)
+	{
+		socket.write("error " + error + "\n");
+		return;
+	}
+	if (request._output.empty())
+	{
+		if (socket.write("ok " + std::to_string(data->size()) + "\n"))
+			socket.write(data->data(), data->size());
+		return;
+	}
+	aulos::FileSink sink{ request._output };
+	if (!sink.isOpen() || !sink.write(data->data(), data->size()) || !sink.commit())
+	{
+		socket.write("error Unable to write output file\n");
+		return;
+	}
+	socket.write("ok 0\n");
+}
+
+std::shared_ptr<const std::vector<std::byte>> Server::audio(const std::string& text, const seir::synth::AudioFormat& format, aulos::OutputFormat outputFormat, std::string& error)
+{
+	const auto textHash = aulos::Hash{}.add(text).value();
+	const auto key = aulos::Hash{}.add(textHash).add(format.samplingRate()).add(format.channelLayout()).add(outputFormat).value();
+	{
+		std::lock_guard lock{ _mutex };
+		if (auto data = _audio.find(key))
+			return data;
+	}
+	const auto packed = composition(text, textHash, error);
+	if (!packed)
+		return {};
+	// Concurrent requests for the same missing result render it independently, the last one replaces the others in the cache.
+	aulos::MemorySink sink;
+	aulos::RenderOptions options;
+	options._outputFormat = outputFormat;
+	if (aulos::render(*packed, format, sink, options) != aulos::RenderStatus::Completed)
+	{
+		error = "Unable to render composition";
+		return {};
+	}
+	auto data = std::make_shared<const std::vector<std::byte>>(sink.release());
+	std::lock_guard lock{ _mutex };
+	_audio.insert(key, data, data->size());
+	return data;
+}
+
+std::shared_ptr<const seir::synth::Composition> Server::composition(const std::string& text, uint64_t textHash, std::string& error)
+{
+	{
+		std::lock_guard lock{ _mutex };
+		if (auto composition = _compositions.find(textHash))
+			return composition;
+	}
+	std::shared_ptr<seir::synth::CompositionData> data;
+	if (const std::span bytes{ reinterpret_cast<const std::byte*>(text.data()), text.size() }; aulos::isBinaryComposition(bytes))
+	{
+		data = aulos::loadBinaryComposition(bytes, error);
+		if (!data)
+			return {};
+	}
+	else
+	{
+		std::unique_ptr<seir::synth::Composition> parsed;
+		try
+		{
+			parsed = seir::synth::Composition::create(text.c_str());
+		}
+		catch (const std::runtime_error& e)
+		{
+			error = e.what();
+			return {};
+		}
+		if (!parsed)
+		{
+			error = "Invalid composition";
+			return {};
+		}
+		data = std::make_shared<seir::synth::CompositionData>(*parsed);
+	}
+	std::shared_ptr<const seir::synth::Composition> packed = aulos::packComposition(*data);
+	if (!packed)
+	{
+		error = "Unable to pack composition";
+		return {};
+	}
+	// The packed composition size is unknown, so the text size serves as an estimate.
+	std::lock_guard lock{ _mutex };
+	_compositions.insert(textHash, packed, text.size());
+	return packed;
+}
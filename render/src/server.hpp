@@ -0,0 +1,40 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "lru_cache.hpp"
+
+#include <aulos_core/render.hpp>
+
+#include <seir_synth/composition.hpp>
+#include <seir_synth/format.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Socket;
+
+// Serves render requests, keeping packed compositions and rendered audio in memory
+// so that repeated requests skip parsing, gain measurement and synthesis.
+class Server
+{
+public:
+	Server(size_t compositionCacheSize, size_t audioCacheSize) noexcept;
+
+	// Processes a single request, may be called from multiple threads simultaneously.
+	void serve(Socket&);
+
+private:
+	std::shared_ptr<const std::vector<std::byte>> audio(const std::string& text, const seir::synth::AudioFormat&, aulos::OutputFormat, std::string& error);
+	std::shared_ptr<const seir::synth::Composition> composition(const std::string& text, uint64_t textHash, std::string& error);
+
+private:
+	std::mutex _mutex;
+	LruCache<seir::synth::Composition> _compositions;
+	LruCache<std::vector<std::byte>> _audio;
+};
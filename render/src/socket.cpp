@@ -0,0 +1,167 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "socket.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+#ifdef MSG_NOSIGNAL
+	constexpr int kSendFlags = MSG_NOSIGNAL; // Report a closed connection as an error instead of raising SIGPIPE.
+#else
+	constexpr int kSendFlags = 0;
+#endif
+
+	bool makeAddress(sockaddr_un& address, const std::string& path) noexcept
+	{
+		std::memset(&address, 0, sizeof address);
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof address.sun_path)
+			return false;
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		return true;
+	}
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: _descriptor{ std::exchange(other._descriptor, -1) }
+	, _bufferOffset{ std::exchange(other._bufferOffset, 0) }
+	, _bufferSize{ std::exchange(other._bufferSize, 0) }
+	, _buffer{ other._buffer }
+{
+}
+
+Socket::~Socket() noexcept
+{
+	if (_descriptor >= 0)
+		::close(_descriptor);
+}
+
+Socket Socket::connect(const std::string& path)
+{
+	sockaddr_un address;
+	if (!::makeAddress(address, path))
+		return {};
+	Socket socket{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+	if (!socket.isOpen() || ::connect(socket._descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0)
+		return {};
+	return socket;
+}
+
+Socket Socket::listen(const std::string& path)
+{
+	sockaddr_un address;
+	if (!::makeAddress(address, path))
+		return {};
+	Socket socket{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+	if (!socket.isOpen())
+		return {};
+	// A socket file left by a crashed daemon makes bind() fail, but a live daemon must not be replaced.
+	if (struct stat status; ::lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode) && !Socket::connect(path).isOpen())
+		::unlink(path.c_str());
+	const auto mask = ::umask(0077);
+	const auto bound = ::bind(socket._descriptor, reinterpret_cast<const sockaddr*>(&address), sizeof address) == 0;
+	::umask(mask);
+	if (!bound || ::listen(socket._descriptor, SOMAXCONN) != 0)
+		return {};
+	return socket;
+}
+
+Socket Socket::accept()
+{
+	for (;;)
+	{
+		if (const auto descriptor = ::accept(_descriptor, nullptr, nullptr); descriptor >= 0)
+			return Socket{ descriptor };
+		if (errno != EINTR && errno != ECONNABORTED)
+			return {};
+	}
+}
+
+bool Socket::read(void* data, size_t size)
+{
+	auto output = static_cast<char*>(data);
+	if (_bufferOffset < _bufferSize)
+	{
+		const auto buffered = std::min(size, _bufferSize - _bufferOffset);
+		std::memcpy(output, _buffer.data() + _bufferOffset, buffered);
+		_bufferOffset += buffered;
+		output += buffered;
+		size -= buffered;
+	}
+	while (size > 0)
+	{
+		const auto received = ::recv(_descriptor, output, size, 0);
+		if (received > 0)
+		{
+			output += received;
+			size -= static_cast<size_t>(received);
+		}
+		else if (received == 0 || errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+bool Socket::readLine(std::string& line)
+{
+	line.clear();
+	for (;;)
+	{
+		const auto begin = _buffer.data() + _bufferOffset;
+		const auto end = _buffer.data() + _bufferSize;
+		if (const auto newline = std::find(begin, end, '\n'); newline != end)
+		{
+			line.append(begin, newline);
+			_bufferOffset += static_cast<size_t>(newline - begin) + 1;
+			return true;
+		}
+		line.append(begin, end);
+		_bufferOffset = _bufferSize;
+		if (line.size() >= _buffer.size() || !fillBuffer())
+			return false;
+	}
+}
+
+bool Socket::write(const void* data, size_t size)
+{
+	auto input = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		const auto sent = ::send(_descriptor, input, size, kSendFlags);
+		if (sent >= 0)
+		{
+			input += sent;
+			size -= static_cast<size_t>(sent);
+		}
+		else if (errno != EINTR)
+			return false;
+	}
+	return true;
+}
+
+bool Socket::fillBuffer()
+{
+	for (;;)
+	{
+		const auto received = ::recv(_descriptor, _buffer.data(), _buffer.size(), 0);
+		if (received > 0)
+		{
+			_bufferOffset = 0;
+			_bufferSize = static_cast<size_t>(received);
+			return true;
+		}
+		if (received == 0 || errno != EINTR)
+			return false;
+	}
+}
@@ -0,0 +1,46 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Unix domain stream socket with buffered reading.
+class Socket
+{
+public:
+	Socket() noexcept = default;
+	Socket(Socket&&) noexcept;
+	~Socket() noexcept;
+
+	// Connects to a listening socket.
+	static Socket connect(const std::string& path);
+	// Creates a listening socket accessible only to the current user, replacing a stale socket file.
+	static Socket listen(const std::string& path);
+
+	// Waits for an incoming connection on a listening socket.
+	Socket accept();
+	bool isOpen() const noexcept { return _descriptor >= 0; }
+	bool read(void* data, size_t size);
+	// Reads a line without the terminating newline.
+	// Fails if the line is longer than the internal buffer.
+	bool readLine(std::string&);
+	bool write(const void* data, size_t size);
+	bool write(std::string_view text) { return write(text.data(), text.size()); }
+
+private:
+	explicit Socket(int descriptor) noexcept
+		: _descriptor{ descriptor } {}
+
+	bool fillBuffer();
+
+private:
+	int _descriptor = -1;
+	size_t _bufferOffset = 0;
+	size_t _bufferSize = 0;
+	std::array<char, 4096> _buffer;
+};
@@ -0,0 +1,79 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "autosaver.hpp"
+
+#include <aulos_core/binary.hpp>
+#include <aulos_core/sink.hpp>
+
+#include <seir_synth/data.hpp>
+
+#include <system_error>
+#include <utility>
+
+Autosaver::Autosaver(const std::filesystem::path& path)
+	: _path{ path }
+	, _thread{ [this] { run(); } }
+{
+}
+
+Autosaver::~Autosaver() noexcept
+{
+	{
+		std::lock_guard lock{ _mutex };
+		_stop = true;
+	}
+	_condition.notify_one();
+	_thread.join();
+}
+
+void Autosaver::discard()
+{
+	{
+		std::lock_guard lock{ _mutex };
+		_snapshot.reset();
+		_discard = true;
+	}
+	_condition.notify_one();
+}
+
+void Autosaver::save(std::shared_ptr<const seir::synth::CompositionData>&& snapshot)
+{
+	{
+		std::lock_guard lock{ _mutex };
+		_snapshot = std::move(snapshot);
+	}
+	_condition.notify_one();
+}
+
+void Autosaver::run()
+{
+	for (;;)
+	{
+		std::shared_ptr<const seir::synth::CompositionData> snapshot;
+		bool discard = false;
+		{
+			std::unique_lock lock{ _mutex };
+			_condition.wait(lock, [this] { return _snapshot || _discard || _stop; });
+			snapshot = std::move(_snapshot);
+			discard = std::exchange(_discard, false);
+			if (!snapshot && !discard)
+				return;
+		}
+		// A discard request drops the snapshots queued before it,
+		// so the snapshot (if any) was queued after the discard request.
+		if (discard)
+		{
+			std::error_code error;
+			std::filesystem::remove(_path, error);
+		}
+		if (snapshot)
+		{
+			// A failed autosave keeps the previous recovery file, and the next one may succeed.
+			aulos::FileSink sink{ _path };
+			if (sink.isOpen() && aulos::saveBinaryComposition(*snapshot, sink))
+				sink.commit();
+		}
+	}
+}
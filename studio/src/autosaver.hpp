@@ -0,0 +1,44 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace seir::synth
+{
+	struct CompositionData;
+}
+
+// Writes composition snapshots into a recovery file on a background thread.
+// The file is written in the binary format and replaced only when complete.
+class Autosaver
+{
+public:
+	explicit Autosaver(const std::filesystem::path&);
+	~Autosaver() noexcept;
+
+	// Removes the recovery file, dropping the snapshot which hasn't been saved yet.
+	void discard();
+	const std::filesystem::path& path() const noexcept { return _path; }
+	// Queues the snapshot for saving, replacing the one which hasn't been saved yet.
+	// The snapshot must not be modified afterwards.
+	void save(std::shared_ptr<const seir::synth::CompositionData>&&);
+
+private:
+	void run();
+
+private:
+	const std::filesystem::path _path;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::shared_ptr<const seir::synth::CompositionData> _snapshot;
+	bool _discard = false;
+	bool _stop = false;
+	std::thread _thread;
+};
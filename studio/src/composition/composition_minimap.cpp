@@ -0,0 +1,215 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "composition_minimap.hpp"
+
+#include "../theme.hpp"
+#include "composition_model.hpp"
+
+#include <seir_synth/data.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+
+namespace
+{
+	// Beyond this, repainting the whole image is cheaper than repainting the changed parts separately.
+	constexpr size_t kMaxDirtyAreas = 64;
+}
+
+CompositionMinimap::CompositionMinimap(const CompositionModel& model, QWidget* parent)
+	: QWidget{ parent }
+	, _model{ model }
+{
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setCursor(Qt::PointingHandCursor);
+	setFixedHeight(kMinimapHeight);
+}
+
+void CompositionMinimap::invalidate()
+{
+	_imageOutdated = true;
+	_dirtyAreas.clear();
+	update();
+}
+
+void CompositionMinimap::invalidateFragments(size_t trackIndex, size_t offset, size_t length)
+{
+	if (_imageOutdated)
+		return;
+	if (_dirtyAreas.size() >= kMaxDirtyAreas)
+	{
+		invalidate();
+		return;
+	}
+	if (trackIndex < _tracks.size())
+	{
+		// The changed fragments may be longer than any fragment the track had before.
+		const auto& fragments = _tracks[trackIndex]->_fragments;
+		auto& maxFragmentLength = _maxFragmentLengths[trackIndex];
+		for (auto i = fragments.lower_bound(offset); i != fragments.end() && i->first < offset + length; ++i)
+			maxFragmentLength = std::max(maxFragmentLength, CompositionModel::fragmentLength(*i->second));
+	}
+	const auto& area = _dirtyAreas.emplace_back(static_cast<qreal>(offset), static_cast<qreal>(trackIndex), static_cast<qreal>(std::max<size_t>(length, 1)), qreal{ 1 }); // Empty fragments are painted a pixel wide.
+	update(areaRect(area).toAlignedRect());
+}
+
+void CompositionMinimap::setVisibleArea(const QRectF& area)
+{
+	if (area == _visibleArea)
+		return;
+	update(areaRect(_visibleArea).toAlignedRect().adjusted(-1, -1, 1, 1));
+	_visibleArea = area;
+	update(areaRect(_visibleArea).toAlignedRect().adjusted(-1, -1, 1, 1));
+}
+
+QRectF CompositionMinimap::areaRect(const QRectF& area) const
+{
+	return { area.left() * _stepWidth, area.top() * _trackHeight, area.width() * _stepWidth, area.height() * _trackHeight };
+}
+
+size_t CompositionMinimap::compositionLength() const
+{
+	// The length is computed from the last fragments of the tracks, the same way the composition scene does it.
+	size_t length = 1;
+	if (const auto& composition = _model.composition())
+		for (const auto& partData : composition->_parts)
+			for (const auto& trackData : partData->_tracks)
+				if (!trackData->_fragments.empty())
+				{
+					const auto& lastFragment = *trackData->_fragments.rbegin();
+					length = std::max(length, lastFragment.first + CompositionModel::fragmentLength(*lastFragment.second));
+				}
+	return length;
+}
+
+void CompositionMinimap::mouseMoveEvent(QMouseEvent* e)
+{
+	if (e->buttons() & Qt::LeftButton)
+		requestPosition(e->pos());
+}
+
+void CompositionMinimap::mousePressEvent(QMouseEvent* e)
+{
+	if (e->button() == Qt::LeftButton)
+		requestPosition(e->pos());
+}
+
+void CompositionMinimap::paintEvent(QPaintEvent* e)
+{
+	const auto devicePixelRatio = devicePixelRatioF();
+	if (const auto imageSize = size() * devicePixelRatio; _image.size() != imageSize || _image.devicePixelRatio() != devicePixelRatio)
+	{
+		_image = QImage{ imageSize, QImage::Format_ARGB32_Premultiplied };
+		_image.setDevicePixelRatio(devicePixelRatio);
+		_imageOutdated = true;
+	}
+	// Changes at the end of the composition may change its length, and so the scale of the whole image.
+	if (!_imageOutdated && !_dirtyAreas.empty() && compositionLength() != _length)
+		_imageOutdated = true;
+	if (_imageOutdated)
+	{
+		updateTracks();
+		_image.fill(kBackgroundColor);
+		QPainter painter{ &_image };
+		paintTracks(painter, { 0, 0, static_cast<qreal>(_length), static_cast<qreal>(_tracks.size()) });
+		_imageOutdated = false;
+		_dirtyAreas.clear();
+		if (e->region() != QRegion{ rect() })
+			update();
+	}
+	else if (!_dirtyAreas.empty())
+	{
+		QPainter painter{ &_image };
+		for (const auto& area : _dirtyAreas)
+			paintTracks(painter, area);
+		_dirtyAreas.clear();
+	}
+
+	QPainter painter{ this };
+	for (const auto& rect : e->region())
+		painter.drawImage(QRectF{ rect }, _image, QRectF{ QPointF{ rect.topLeft() } * devicePixelRatio, QSizeF{ rect.size() } * devicePixelRatio });
+	if (!_visibleArea.isEmpty())
+	{
+		painter.setPen(kMinimapViewColors._pen);
+		painter.setBrush(kMinimapViewColors._brush);
+		painter.drawRect(areaRect(_visibleArea).intersected(QRectF{ rect() }).adjusted(0, 0, -1, -1));
+	}
+}
+
+void CompositionMinimap::paintTracks(QPainter& painter, const QRectF& area) const
+{
+	const auto pixelRect = areaRect(area).toAlignedRect().intersected(rect());
+	if (pixelRect.isEmpty())
+		return;
+	painter.setClipRect(pixelRect);
+	painter.fillRect(pixelRect, kBackgroundColor);
+	if (_tracks.empty())
+		return;
+	const auto firstTrack = static_cast<size_t>(std::floor(pixelRect.top() / _trackHeight));
+	const auto lastTrack = std::min(static_cast<size_t>(std::ceil((pixelRect.bottom() + 1) / _trackHeight)), _tracks.size());
+	const auto firstStep = pixelRect.left() / _stepWidth;
+	const auto lastStep = (pixelRect.right() + 1) / _stepWidth;
+	for (auto trackIndex = firstTrack; trackIndex < lastTrack; ++trackIndex)
+	{
+		const QRectF row{ 0, trackIndex * _trackHeight, static_cast<qreal>(width()), _trackHeight };
+		painter.fillRect(row, kTrackColors[trackIndex % kTrackColors.size()]._colors[0]);
+		// Fragments which overlap in the image are merged, so that zoomed out compositions aren't painted fragment by fragment.
+		const auto& color = kFragmentColors[trackIndex % kFragmentColors.size()]._brush;
+		qreal runLeft = 0;
+		qreal runRight = 0;
+		// Only the fragments starting within the longest fragment length before the area may reach into it.
+		const auto& fragments = _tracks[trackIndex]->_fragments;
+		const auto firstOffset = static_cast<size_t>(firstStep);
+		const auto maxFragmentLength = _maxFragmentLengths[trackIndex];
+		for (auto i = fragments.lower_bound(firstOffset > maxFragmentLength ? firstOffset - maxFragmentLength : 0); i != fragments.end() && i->first < lastStep; ++i)
+		{
+			const auto& [offset, sequence] = *i;
+			const auto end = offset + CompositionModel::fragmentLength(*sequence);
+			if (end <= firstStep)
+				continue;
+			const auto left = offset * _stepWidth;
+			if (left > runRight)
+			{
+				if (runRight > runLeft)
+					painter.fillRect(QRectF{ runLeft, row.top(), runRight - runLeft, row.height() }, color);
+				runLeft = left;
+			}
+			runRight = std::max({ runRight, end * _stepWidth, left + 1 }); // Every fragment is at least a pixel wide.
+		}
+		if (runRight > runLeft)
+			painter.fillRect(QRectF{ runLeft, row.top(), runRight - runLeft, row.height() }, color);
+	}
+}
+
+void CompositionMinimap::requestPosition(const QPoint& pos)
+{
+	if (_stepWidth > 0 && _trackHeight > 0)
+		emit positionRequested({ pos.x() / _stepWidth, std::min(pos.y() / _trackHeight, static_cast<qreal>(_tracks.size())) });
+}
+
+void CompositionMinimap::resizeEvent(QResizeEvent* e)
+{
+	QWidget::resizeEvent(e);
+	invalidate();
+}
+
+void CompositionMinimap::updateTracks()
+{
+	_tracks.clear();
+	if (const auto& composition = _model.composition())
+		for (const auto& partData : composition->_parts)
+			_tracks.insert(_tracks.end(), partData->_tracks.cbegin(), partData->_tracks.cend());
+	_maxFragmentLengths.assign(_tracks.size(), 0);
+	for (size_t i = 0; i < _tracks.size(); ++i)
+		for (const auto& fragment : _tracks[i]->_fragments)
+			_maxFragmentLengths[i] = std::max(_maxFragmentLengths[i], CompositionModel::fragmentLength(*fragment.second));
+	_length = compositionLength();
+	_stepWidth = static_cast<qreal>(width()) / _length;
+	_trackHeight = _tracks.empty() ? 0 : std::min(kMaxMinimapTrackHeight, static_cast<qreal>(height()) / _tracks.size());
+}
@@ -0,0 +1,59 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QWidget>
+
+namespace seir::synth
+{
+	struct TrackData;
+}
+
+class CompositionModel;
+
+// Shows the fragments of the whole composition, scaled to fit the widget, and the visible part of it.
+// The overview is kept in an image, and only the changed parts of it are painted again.
+// Areas are specified in steps horizontally and in tracks vertically.
+class CompositionMinimap final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	CompositionMinimap(const CompositionModel&, QWidget* parent);
+
+	void invalidate();
+	void invalidateFragments(size_t trackIndex, size_t offset, size_t length);
+	void setVisibleArea(const QRectF&);
+
+signals:
+	void positionRequested(const QPointF&);
+
+private:
+	QRectF areaRect(const QRectF&) const;
+	size_t compositionLength() const;
+	void mouseMoveEvent(QMouseEvent*) override;
+	void mousePressEvent(QMouseEvent*) override;
+	void paintEvent(QPaintEvent*) override;
+	void paintTracks(QPainter&, const QRectF& area) const;
+	void requestPosition(const QPoint&);
+	void resizeEvent(QResizeEvent*) override;
+	void updateTracks();
+
+private:
+	const CompositionModel& _model;
+	QImage _image;
+	bool _imageOutdated = true;
+	std::vector<QRectF> _dirtyAreas; // The parts of the image that don't match the composition.
+	std::vector<std::shared_ptr<seir::synth::TrackData>> _tracks;
+	std::vector<size_t> _maxFragmentLengths; // Never decrease until the whole image is repainted.
+	size_t _length = 0;
+	qreal _stepWidth = 0;
+	qreal _trackHeight = 0;
+	QRectF _visibleArea;
+};
@@ -0,0 +1,155 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "composition_model.hpp"
+
+#include <seir_synth/data.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+void CompositionModel::reset(const std::shared_ptr<seir::synth::CompositionData>& composition)
+{
+	_composition = composition;
+	_parts.clear();
+	_tracks.clear();
+	_sequences.clear();
+	_totalTrackWeight = 0;
+	if (_composition)
+		for (const auto& part : _composition->_parts)
+			indexPart(part);
+}
+
+size_t CompositionModel::fragmentLength(const seir::synth::SequenceData& sequence)
+{
+	if (sequence._sounds.empty())
+		return 0;
+	const auto length = std::accumulate(sequence._sounds.begin(), sequence._sounds.end(), size_t{ 1 }, [](size_t length, const seir::synth::Sound& sound) { return length + sound._delay; });
+	const auto last = std::find_if(sequence._sounds.rbegin(), sequence._sounds.rend(), [](const seir::synth::Sound& sound) { return sound._delay != 0; });
+	return length + (last != sequence._sounds.rend() ? last->_sustain : sequence._sounds.front()._sustain);
+}
+
+std::shared_ptr<seir::synth::PartData> CompositionModel::part(const void* voiceId) const
+{
+	const auto i = _parts.find(voiceId);
+	return i != _parts.end() ? i->second : nullptr;
+}
+
+std::shared_ptr<seir::synth::SequenceData> CompositionModel::sequence(const void* sequenceId) const
+{
+	const auto i = _sequences.find(sequenceId);
+	return i != _sequences.end() ? i->second : nullptr;
+}
+
+std::shared_ptr<seir::synth::TrackData> CompositionModel::track(const void* trackId) const
+{
+	const auto i = _tracks.find(trackId);
+	return i != _tracks.end() ? i->second._track : nullptr;
+}
+
+std::shared_ptr<seir::synth::PartData> CompositionModel::trackPart(const void* trackId) const
+{
+	const auto i = _tracks.find(trackId);
+	return i != _tracks.end() ? i->second._part : nullptr;
+}
+
+float CompositionModel::trackWeight(const void* trackId) const
+{
+	const auto i = _tracks.find(trackId);
+	assert(i != _tracks.end());
+	assert(_totalTrackWeight > 0);
+	return static_cast<float>(i->second._track->_properties->_weight) / _totalTrackWeight;
+}
+
+void CompositionModel::updateTotalTrackWeight()
+{
+	_totalTrackWeight = 0;
+	for (const auto& entry : _tracks)
+		_totalTrackWeight += entry.second._track->_properties->_weight;
+}
+
+void CompositionModel::addSequence(const void* trackId, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+{
+	const auto i = _tracks.find(trackId);
+	assert(i != _tracks.end());
+	i->second._track->_sequences.emplace_back(sequence);
+	_sequences.emplace(sequence.get(), sequence);
+}
+
+void CompositionModel::addTrack(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>& track)
+{
+	const auto i = _parts.find(voiceId);
+	assert(i != _parts.end());
+	i->second->_tracks.emplace_back(track);
+	indexTrack(i->second, track);
+}
+
+void CompositionModel::appendPart(const std::shared_ptr<seir::synth::PartData>& part)
+{
+	_composition->_parts.emplace_back(part);
+	indexPart(part);
+}
+
+bool CompositionModel::insertFragment(const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+{
+	const auto i = _tracks.find(trackId);
+	assert(i != _tracks.end());
+	assert(_sequences.find(sequence.get()) != _sequences.end());
+	return i->second._track->_fragments.emplace(offset, sequence).second;
+}
+
+void CompositionModel::removeFragment(const void* trackId, size_t offset)
+{
+	const auto i = _tracks.find(trackId);
+	assert(i != _tracks.end());
+	[[maybe_unused]] const auto erased = i->second._track->_fragments.erase(offset);
+	assert(erased);
+}
+
+void CompositionModel::removePart(const void* voiceId)
+{
+	const auto i = _parts.find(voiceId);
+	assert(i != _parts.end());
+	for (const auto& track : i->second->_tracks)
+		unindexTrack(*track);
+	const auto partIt = std::find(_composition->_parts.begin(), _composition->_parts.end(), i->second);
+	assert(partIt != _composition->_parts.end());
+	_composition->_parts.erase(partIt);
+	_parts.erase(i);
+}
+
+void CompositionModel::removeTrack(const void* trackId)
+{
+	const auto i = _tracks.find(trackId);
+	assert(i != _tracks.end());
+	auto& tracks = i->second._part->_tracks;
+	const auto trackIt = std::find(tracks.begin(), tracks.end(), i->second._track);
+	assert(trackIt != tracks.end());
+	unindexTrack(**trackIt);
+	tracks.erase(trackIt);
+}
+
+void CompositionModel::indexPart(const std::shared_ptr<seir::synth::PartData>& part)
+{
+	_parts.emplace(part->_voice.get(), part);
+	for (const auto& track : part->_tracks)
+		indexTrack(part, track);
+}
+
+void CompositionModel::indexTrack(const std::shared_ptr<seir::synth::PartData>& part, const std::shared_ptr<seir::synth::TrackData>& track)
+{
+	_tracks.emplace(track.get(), TrackEntry{ part, track });
+	_totalTrackWeight += track->_properties->_weight;
+	for (const auto& sequence : track->_sequences)
+		_sequences.emplace(sequence.get(), sequence);
+}
+
+void CompositionModel::unindexTrack(const seir::synth::TrackData& track)
+{
+	for (const auto& sequence : track._sequences)
+		_sequences.erase(sequence.get());
+	_totalTrackWeight -= track._properties->_weight;
+	_tracks.erase(&track);
+}
@@ -0,0 +1,65 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+namespace seir::synth
+{
+	struct CompositionData;
+	struct PartData;
+	struct SequenceData;
+	struct TrackData;
+}
+
+// Composition data indexed by the identifiers the composition view uses for voices, tracks and sequences.
+// Parts, tracks, sequences and fragments must be added and removed through the model to keep the indices valid.
+class CompositionModel
+{
+public:
+	const std::shared_ptr<seir::synth::CompositionData>& composition() const noexcept { return _composition; }
+	void reset(const std::shared_ptr<seir::synth::CompositionData>&);
+
+	// Returns the number of steps the fragment of the sequence occupies, must match the length computed by FragmentLayout.
+	static size_t fragmentLength(const seir::synth::SequenceData&);
+
+	// Lookups return null if there is no object with the specified identifier.
+	std::shared_ptr<seir::synth::PartData> part(const void* voiceId) const;
+	std::shared_ptr<seir::synth::SequenceData> sequence(const void* sequenceId) const;
+	std::shared_ptr<seir::synth::TrackData> track(const void* trackId) const;
+	std::shared_ptr<seir::synth::PartData> trackPart(const void* trackId) const;
+	float trackWeight(const void* trackId) const;
+
+	// Track weights are edited in place, so the total weight must be updated explicitly after that.
+	void updateTotalTrackWeight();
+
+	void addSequence(const void* trackId, const std::shared_ptr<seir::synth::SequenceData>&);
+	void addTrack(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>&);
+	void appendPart(const std::shared_ptr<seir::synth::PartData>&);
+	bool insertFragment(const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>&);
+	void removeFragment(const void* trackId, size_t offset);
+	void removePart(const void* voiceId);
+	void removeTrack(const void* trackId);
+
+private:
+	void indexPart(const std::shared_ptr<seir::synth::PartData>&);
+	void indexTrack(const std::shared_ptr<seir::synth::PartData>&, const std::shared_ptr<seir::synth::TrackData>&);
+	void unindexTrack(const seir::synth::TrackData&);
+
+private:
+	struct TrackEntry
+	{
+		std::shared_ptr<seir::synth::PartData> _part;
+		std::shared_ptr<seir::synth::TrackData> _track;
+	};
+
+	std::shared_ptr<seir::synth::CompositionData> _composition;
+	std::unordered_map<const void*, std::shared_ptr<seir::synth::PartData>> _parts;
+	std::unordered_map<const void*, TrackEntry> _tracks;
+	std::unordered_map<const void*, std::shared_ptr<seir::synth::SequenceData>> _sequences;
+	unsigned _totalTrackWeight = 0;
+};
@@ -4,29 +4,36 @@
 
 #include "composition_scene.hpp"
 
-#include "../elusive_item.hpp"
 #include "../theme.hpp"
 #include "add_voice_item.hpp"
-#include "cursor_item.hpp"
+#include "composition_model.hpp"
 #include "fragment_item.hpp"
 #include "loop_item.hpp"
 #include "timeline_item.hpp"
 #include "track_item.hpp"
 #include "voice_item.hpp"
+#include "waveform_analyzer.hpp"
+#include "waveform_item.hpp"
 
 #include <seir_synth/data.hpp>
 
+#include <algorithm>
 #include <cassert>
-#include <numeric>
+#include <cmath>
+#include <set>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <QGraphicsRectItem>
+#include <QTimer>
 
 namespace
 {
+	constexpr qreal kTrackZValue = -1; // Track backgrounds are shown under the fragments.
 	constexpr qreal kDefaultZValue = 0;
 	constexpr qreal kHighlightZValue = 1;
-	constexpr qreal kCursorZValue = 2;
+	constexpr qreal kWaveformZValue = 2; // Waveforms are shown over the fragments.
 
 	const std::array<QString, 7> kNoteNameTemplates{
 		QStringLiteral("C<%1>%2</%1>"),
@@ -59,16 +66,18 @@ namespace
 		NoteInfo{ 6, false }, // B
 	};
 
-	auto findVoice(const std::vector<std::unique_ptr<VoiceItem>>& voices, const void* id)
+	// Later fragments are shown over the earlier ones they overlap, and the z-value keeps that order
+	// within the highlighting level, so that the items don't have to be restacked relative to their neighbors.
+	qreal fragmentZValue(size_t offset, bool highlighted) noexcept
 	{
-		size_t offset = 0;
-		for (auto i = voices.begin(); i != voices.end(); ++i)
-		{
-			if ((*i)->voiceId() == id)
-				return std::pair{ i, offset };
-			offset += (*i)->trackCount();
-		}
-		return std::pair{ voices.end(), offset };
+		const auto position = static_cast<qreal>(offset);
+		return (highlighted ? kHighlightZValue : kDefaultZValue) + position / (position + 1);
+	}
+
+	// Returns the range of items of the specified size which intersect the specified coordinate range.
+	std::pair<size_t, size_t> itemRange(qreal begin, qreal end, qreal itemSize)
+	{
+		return { static_cast<size_t>(std::floor(std::max(begin, qreal{ 0 }) / itemSize)), static_cast<size_t>(std::ceil(std::max(end, qreal{ 0 }) / itemSize)) };
 	}
 }
 
@@ -79,19 +88,42 @@ private:
 	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override {}
 };
 
+struct CompositionScene::CachedLayout
+{
+	std::weak_ptr<const seir::synth::SequenceData> _sequence; // Detects identifiers reused by new sequences.
+	std::shared_ptr<const FragmentLayout> _layout;
+};
+
 struct CompositionScene::Track
 {
-	QGraphicsScene& _scene;
+	CompositionScene& _scene;
+	const void* const _voiceId;
+	const std::shared_ptr<seir::synth::TrackData> _data;
+	size_t _index; // The items are moved to it by the next layout pass.
 	TrackItem* _background = nullptr;
-	std::map<size_t, FragmentItem*> _fragments;
-
-	explicit Track(QGraphicsScene& scene)
-		: _scene{ scene } {}
+	WaveformItem* _waveform = nullptr;                                  // Exists only if the waveforms are visible.
+	std::map<size_t, FragmentItem*> _fragments;                         // Only the fragments in the populated area have items.
+	std::unordered_map<const void*, std::set<size_t>> _sequenceOffsets; // The offsets of all fragments of each sequence, populated or not.
+	size_t _maxFragmentLength = 0;                                      // Never decreases, which is fine for finding the fragments that cover a position.
+	bool _waveformOutdated = false;
+
+	Track(CompositionScene& scene, const void* voiceId, const std::shared_ptr<seir::synth::TrackData>& data, size_t index)
+		: _scene{ scene }, _voiceId{ voiceId }, _data{ data }, _index{ index }
+	{
+		for (const auto& sequence : _data->_sequences)
+			_maxFragmentLength = std::max(_maxFragmentLength, CompositionModel::fragmentLength(*sequence));
+		for (const auto& [offset, sequence] : _data->_fragments)
+		{
+			auto& offsets = _sequenceOffsets[sequence.get()];
+			offsets.emplace_hint(offsets.end(), offset);
+		}
+	}
 
 	~Track()
 	{
 		_background->deleteLater();
 		_scene.removeItem(_background);
+		delete _waveform;
 		for (auto& fragment : _fragments)
 		{
 			fragment.second->deleteLater();
@@ -99,28 +131,50 @@ struct CompositionScene::Track
 		}
 	}
 
-	void setIndex(size_t index)
+	void removeSequenceOffset(size_t offset)
 	{
-		const auto y = index * kTrackHeight;
+		const auto erase = [this, offset](decltype(_sequenceOffsets)::iterator i) {
+			if (!i->second.erase(offset))
+				return false;
+			if (i->second.empty())
+				_sequenceOffsets.erase(i);
+			return true;
+		};
+		if (const auto i = _data->_fragments.find(offset); i != _data->_fragments.end())
+			if (const auto j = _sequenceOffsets.find(i->second.get()); j != _sequenceOffsets.end() && erase(j))
+				return;
+		// The fragment may be gone from the data already, and then its sequence has to be found in the index.
+		for (auto i = _sequenceOffsets.begin(); i != _sequenceOffsets.end(); ++i)
+			if (erase(i))
+				return;
+	}
+
+	void updateItems()
+	{
+		if (_background->trackIndex() == _index)
+			return;
+		const auto y = _index * kTrackHeight;
 		_background->setPos(0, y);
-		_background->setTrackIndex(index);
+		_background->setTrackIndex(_index);
+		if (_waveform)
+			_waveform->setPos(0, y + kTrackHeight - kWaveformLaneHeight);
 		for (const auto& fragment : _fragments)
 		{
-			fragment.second->setPos(fragment.second->fragmentOffset() * kStepWidth, y);
-			fragment.second->setTrackIndex(index);
+			fragment.second->setPos(fragment.second->fragmentOffset() * _scene._stepWidth, y);
+			fragment.second->setTrackIndex(_index);
 		}
 	}
 };
 
-CompositionScene::CompositionScene(QObject* parent)
+CompositionScene::CompositionScene(const CompositionModel& model, QObject* parent)
 	: QGraphicsScene{ parent }
+	, _model{ model }
 	, _addVoiceItem{ std::make_unique<AddVoiceItem>() }
 	, _compositionItem{ std::make_unique<CompositionItem>() }
 	, _timelineItem{ new TimelineItem{ _compositionItem.get() } }
-	, _rightBoundItem{ new ElusiveItem{ _compositionItem.get() } }
-	, _cursorItem{ new CursorItem{ _compositionItem.get() } }
 	, _loopItem{ new LoopItem{ _compositionItem.get() } }
 	, _voiceColumnWidth{ kMinVoiceItemWidth }
+	, _stepWidth{ kStepWidth }
 {
 	setBackgroundBrush(kBackgroundColor);
 	_addVoiceItem->setWidth(_voiceColumnWidth);
@@ -128,14 +182,6 @@ CompositionScene::CompositionScene(QObject* parent)
 	_compositionItem->setPos(_voiceColumnWidth, kCompositionHeaderHeight);
 	_timelineItem->setPos(0, -kCompositionHeaderHeight);
 	connect(_timelineItem, &TimelineItem::menuRequested, this, &CompositionScene::timelineMenuRequested);
-	_rightBoundItem->setPos(_timelineItem->pos() + _timelineItem->boundingRect().topRight());
-	connect(_rightBoundItem, &ElusiveItem::elude, [this] {
-		const auto length = _timelineItem->compositionLength();
-		const auto speed = _timelineItem->compositionSpeed();
-		setCompositionLength(length + (speed - length % speed));
-	});
-	_cursorItem->setVisible(false);
-	_cursorItem->setZValue(kCursorZValue);
 	_loopItem->setVisible(false);
 	connect(_loopItem, &LoopItem::menuRequested, this, &CompositionScene::loopMenuRequested);
 
@@ -164,24 +210,17 @@ CompositionScene::CompositionScene(QObject* parent)
 
 CompositionScene::~CompositionScene() = default;
 
-void CompositionScene::addTrack(const void* voiceId, const void* trackId)
+void CompositionScene::addTrack(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>& trackData)
 {
-	const auto [voiceIt, voiceOffset] = ::findVoice(_voices, voiceId);
-	assert(voiceIt != _voices.end());
-	const auto trackOffset = (*voiceIt)->trackCount();
-	const auto trackIndex = voiceOffset + trackOffset;
-	const auto trackIt = addTrackItem(voiceId, trackId, trackIndex, trackOffset == 0);
+	const auto voiceIt = _voiceIds.find(voiceId);
+	assert(voiceIt != _voiceIds.end());
+	const auto firstTrackIt = _voiceFirstTracks.find(voiceId);
+	assert(firstTrackIt != _voiceFirstTracks.end());
+	const auto trackOffset = voiceIt->second->trackCount();
+	const auto trackIt = addTrackItem(voiceId, trackData, firstTrackIt->second->_index + trackOffset, false);
 	(*trackIt)->_background->setTrackLength(_timelineItem->compositionLength());
-	(*voiceIt)->setTrackCount(trackOffset + 1);
-	std::for_each(std::next(voiceIt), _voices.cend(), [index = trackIndex + 1](const auto& voiceItem) mutable {
-		voiceItem->setPos(0, kCompositionHeaderHeight + index * kTrackHeight);
-		index += voiceItem->trackCount();
-	});
-	std::for_each(std::next(trackIt), _tracks.end(), [index = trackIndex + 1](const auto& trackPtr) mutable { trackPtr->setIndex(index++); });
-	_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
-	_cursorItem->setTrackCount(_tracks.size());
-	_loopItem->setPos(_composition->_loopOffset * kStepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
-	updateSceneRect(_timelineItem->compositionLength());
+	voiceIt->second->setTrackCount(trackOffset + 1);
+	updateLayout();
 }
 
 void CompositionScene::appendPart(const std::shared_ptr<seir::synth::PartData>& partData)
@@ -191,7 +230,7 @@ void CompositionScene::appendPart(const std::shared_ptr<seir::synth::PartData>&
 
 	const auto voiceItem = addVoiceItem(partData->_voice.get(), QString::fromStdString(partData->_voiceName), partData->_tracks.size());
 
-	const auto trackIt = addTrackItem(partData->_voice.get(), partData->_tracks.front().get(), _tracks.size(), true);
+	const auto trackIt = addTrackItem(partData->_voice.get(), partData->_tracks.front(), _tracks.size(), true);
 	(*trackIt)->_background->setTrackLength(_timelineItem->compositionLength());
 
 	bool shouldUpdateVoiceColumnWidth = false;
@@ -202,60 +241,91 @@ void CompositionScene::appendPart(const std::shared_ptr<seir::synth::PartData>&
 	}
 	else
 		voiceItem->setWidth(_voiceColumnWidth);
-	updateSceneRect(_timelineItem->compositionLength());
 	if (shouldUpdateVoiceColumnWidth)
 		setVoiceColumnWidth(_voiceColumnWidth);
 
 	addItem(voiceItem);
 	voiceItem->stackBefore(_addVoiceItem.get());
+	updateLayout();
+}
 
-	_addVoiceItem->setIndex(_voices.size());
-	_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
-	_cursorItem->setTrackCount(_tracks.size());
-	_loopItem->setPos(_composition->_loopOffset * kStepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
+void CompositionScene::beginTransaction() noexcept
+{
+	++_transactionDepth;
+}
+
+void CompositionScene::commitTransaction()
+{
+	assert(_transactionDepth > 0);
+	if (!--_transactionDepth && _layoutPending)
+		updateLayout();
 }
 
-void CompositionScene::insertFragment(const void* voiceId, const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+QRectF CompositionScene::cursorRect() const
 {
-	const auto trackIt = std::find_if(_tracks.begin(), _tracks.end(), [trackId](const auto& trackPtr) { return trackPtr->_background->trackId() == trackId; });
-	assert(trackIt != _tracks.end());
-	addFragmentItem(voiceId, trackIt, offset, sequence);
+	return { _voiceColumnWidth + _currentStep * _stepWidth, kCompositionHeaderHeight - kTimelineHeight, kCursorWidth, kTimelineHeight + _tracks.size() * kTrackHeight };
+}
+
+void CompositionScene::extendCompositionLength()
+{
+	auto compositionLength = _timelineItem->compositionLength();
+	for (const auto& partData : _model.composition()->_parts)
+		for (const auto& trackData : partData->_tracks)
+			if (!trackData->_fragments.empty())
+			{
+				const auto& lastFragment = *trackData->_fragments.rbegin();
+				compositionLength = std::max(compositionLength, lastFragment.first + CompositionModel::fragmentLength(*lastFragment.second));
+			}
+	if (compositionLength > _timelineItem->compositionLength())
+		setCompositionLength(compositionLength);
+}
+
+void CompositionScene::insertFragment(const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+{
+	const auto trackIt = findTrack(trackId);
+	const auto length = CompositionModel::fragmentLength(*sequence);
+	(*trackIt)->_maxFragmentLength = std::max((*trackIt)->_maxFragmentLength, length);
+	(*trackIt)->_sequenceOffsets[sequence.get()].emplace(offset);
+	if (isPopulated((*trackIt)->_index, offset, length))
+		acquireFragmentItem(trackIt, offset, sequence);
+	scheduleWaveformUpdate(**trackIt);
+	emit fragmentsChanged((*trackIt)->_index, offset, length);
 }
 
 void CompositionScene::removeFragment(const void* trackId, size_t offset)
 {
-	const auto trackIt = std::find_if(_tracks.begin(), _tracks.end(), [trackId](const auto& trackPtr) { return trackPtr->_background->trackId() == trackId; });
-	assert(trackIt != _tracks.end());
-	const auto fragmentIt = (*trackIt)->_fragments.find(offset);
-	assert(fragmentIt != (*trackIt)->_fragments.end());
-	fragmentIt->second->deleteLater();
-	removeItem(fragmentIt->second);
-	(*trackIt)->_fragments.erase(fragmentIt);
+	const auto trackIt = findTrack(trackId);
+	if (const auto fragmentIt = (*trackIt)->_fragments.find(offset); fragmentIt != (*trackIt)->_fragments.end())
+	{
+		releaseFragmentItem(fragmentIt->second);
+		(*trackIt)->_fragments.erase(fragmentIt);
+	}
+	(*trackIt)->removeSequenceOffset(offset);
+	scheduleWaveformUpdate(**trackIt);
+	emit fragmentsChanged((*trackIt)->_index, offset, (*trackIt)->_maxFragmentLength); // The fragment may be gone from the data already.
 }
 
 void CompositionScene::removeTrack(const void* voiceId, const void* trackId)
 {
-	const auto [voiceIt, voiceOffset] = ::findVoice(_voices, voiceId);
-	assert(voiceIt != _voices.end());
-	const auto trackIt = std::find_if(_tracks.begin(), _tracks.end(), [trackId](const auto& trackPtr) { return trackPtr->_background->trackId() == trackId; });
-	assert(trackIt != _tracks.end());
-	(*voiceIt)->setTrackCount((*voiceIt)->trackCount() - 1);
-	std::for_each(std::next(voiceIt), _voices.cend(), [index = voiceOffset + (*voiceIt)->trackCount()](const auto& voiceItem) mutable {
-		voiceItem->setPos(0, kCompositionHeaderHeight + index * kTrackHeight);
-		index += voiceItem->trackCount();
-	});
+	const auto voiceIt = _voiceIds.find(voiceId);
+	assert(voiceIt != _voiceIds.end());
+	const auto firstTrackIt = _voiceFirstTracks.find(voiceId);
+	assert(firstTrackIt != _voiceFirstTracks.end());
+	const auto trackIt = findTrack(trackId);
+	voiceIt->second->setTrackCount(voiceIt->second->trackCount() - 1);
 	if (const auto nextTrackIt = std::next(trackIt); nextTrackIt != _tracks.end())
 	{
-		const auto trackIndex = (*trackIt)->_background->trackIndex();
-		if (trackIndex == voiceOffset)
+		if (firstTrackIt->second == trackIt->get())
+		{
+			assert((*nextTrackIt)->_voiceId == voiceId);
 			(*nextTrackIt)->_background->setFirstTrack(true);
-		std::for_each(nextTrackIt, _tracks.end(), [index = trackIndex](const auto& trackPtr) mutable { trackPtr->setIndex(index++); });
+			firstTrackIt->second = nextTrackIt->get();
+		}
+		std::for_each(nextTrackIt, _tracks.end(), [](const auto& trackPtr) { --trackPtr->_index; });
 	}
+	_trackIds.erase(trackId);
 	_tracks.erase(trackIt);
-	_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
-	_cursorItem->setTrackCount(_tracks.size());
-	_loopItem->setPos(_composition->_loopOffset * kStepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
-	updateSceneRect(_timelineItem->compositionLength());
+	updateLayout();
 	if (trackId == _selectedTrackId)
 	{
 		_selectedTrackId = nullptr;
@@ -267,24 +337,22 @@ void CompositionScene::removeTrack(const void* voiceId, const void* trackId)
 
 void CompositionScene::removeVoice(const void* voiceId)
 {
-	const auto [voiceIt, voiceOffset] = ::findVoice(_voices, voiceId);
-	assert(voiceIt != _voices.end());
-	removeItem(voiceIt->get());
-	std::for_each(std::next(voiceIt), _voices.cend(), [index = voiceOffset](const auto& voiceItem) mutable {
-		voiceItem->setPos(0, kCompositionHeaderHeight + index * kTrackHeight);
-		voiceItem->setVoiceIndex(voiceItem->voiceIndex() - 1);
-		index += voiceItem->trackCount();
-	});
-	const auto tracksBegin = _tracks.begin() + voiceOffset;
-	const auto tracksEnd = tracksBegin + (*voiceIt)->trackCount();
-	std::for_each(tracksEnd, _tracks.end(), [index = voiceOffset](const auto& trackPtr) mutable { trackPtr->setIndex(index++); });
+	const auto voiceIt = _voiceIds.find(voiceId);
+	assert(voiceIt != _voiceIds.end());
+	const auto voiceItem = voiceIt->second;
+	const auto firstTrackIt = _voiceFirstTracks.find(voiceId);
+	assert(firstTrackIt != _voiceFirstTracks.end());
+	removeItem(voiceItem);
+	const auto tracksBegin = _tracks.begin() + firstTrackIt->second->_index;
+	const auto tracksEnd = tracksBegin + voiceItem->trackCount();
+	std::for_each(tracksEnd, _tracks.end(), [count = voiceItem->trackCount()](const auto& trackPtr) { trackPtr->_index -= count; });
+	std::for_each(tracksBegin, tracksEnd, [this](const auto& trackPtr) { _trackIds.erase(trackPtr->_data.get()); });
 	_tracks.erase(tracksBegin, tracksEnd);
-	_voices.erase(voiceIt);
-	_addVoiceItem->setIndex(_voices.size());
-	_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
-	_cursorItem->setTrackCount(_tracks.size());
-	_loopItem->setPos(_composition->_loopOffset * kStepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
-	updateSceneRect(_timelineItem->compositionLength());
+	_voiceFirstTracks.erase(firstTrackIt);
+	_voiceIds.erase(voiceIt);
+	// Voice indices may be outdated within a transaction, but erasing from the vector is linear anyway.
+	_voices.erase(std::find_if(_voices.begin(), _voices.end(), [voiceItem](const auto& voicePtr) { return voicePtr.get() == voiceItem; }));
+	updateLayout();
 	if (voiceId == _selectedVoiceId)
 	{
 		_selectedVoiceId = nullptr;
@@ -295,46 +363,79 @@ void CompositionScene::removeVoice(const void* voiceId)
 	}
 }
 
-void CompositionScene::reset(const std::shared_ptr<seir::synth::CompositionData>& composition, size_t viewWidth)
+void CompositionScene::refreshSelection()
+{
+	// Revalidates the selection against the composition data and reports it again,
+	// so that the selected objects which were modified in place are shown updated.
+	const void* voiceId = nullptr;
+	const void* trackId = nullptr;
+	const void* sequenceId = nullptr;
+	size_t offset = 0;
+	if (const auto part = _model.part(_selectedVoiceId))
+	{
+		voiceId = _selectedVoiceId;
+		if (const auto track = _model.track(_selectedTrackId); track && _model.trackPart(_selectedTrackId) == part)
+		{
+			trackId = _selectedTrackId;
+			if (const auto fragmentIt = track->_fragments.find(_selectedFragmentOffset); fragmentIt != track->_fragments.end() && fragmentIt->second.get() == _selectedSequenceId)
+			{
+				sequenceId = _selectedSequenceId;
+				offset = _selectedFragmentOffset;
+			}
+		}
+	}
+	selectFragment(voiceId, trackId, sequenceId, offset);
+}
+
+void CompositionScene::reset()
 {
-	if (_composition)
+	if (_compositionItem->scene())
 	{
+		_trackIds.clear();
+		_voiceFirstTracks.clear();
 		_tracks.clear();
+		for (const auto item : _fragmentPool)
+		{
+			item->deleteLater();
+			removeItem(item);
+		}
+		_fragmentPool.clear();
+		_layouts.clear();
 		removeItem(_compositionItem.get());
 		removeItem(_addVoiceItem.get());
+		_voiceIds.clear();
 		_voices.clear();
 		clear();
 	}
-	_composition = composition;
-	if (_composition)
+	if (const auto& composition = _model.composition())
 	{
-		auto compositionLength = viewWidth / static_cast<size_t>(kStepWidth) + 1;
-		_voices.reserve(_composition->_parts.size());
-		for (const auto& partData : _composition->_parts)
+		// Fragment items are created only for the visible area, so the composition length is computed from the data.
+		auto compositionLength = static_cast<size_t>(std::max(_visibleRect.width() - _voiceColumnWidth, qreal{ 0 }) / _stepWidth) + 1;
+		_voices.reserve(composition->_parts.size());
+		for (const auto& partData : composition->_parts)
 		{
 			assert(!partData->_tracks.empty());
-			const auto voiceItem = addVoiceItem(partData->_voice.get(), QString::fromStdString(partData->_voiceName), partData->_tracks.size());
+			addVoiceItem(partData->_voice.get(), QString::fromStdString(partData->_voiceName), partData->_tracks.size());
 			for (const auto& trackData : partData->_tracks)
 			{
-				const auto trackIt = addTrackItem(partData->_voice.get(), trackData.get(), _tracks.size(), trackData == partData->_tracks.front());
-				for (const auto& fragment : trackData->_fragments)
+				addTrackItem(partData->_voice.get(), trackData, _tracks.size(), trackData == partData->_tracks.front());
+				if (!trackData->_fragments.empty())
 				{
-					const auto fragmentItem = addFragmentItem(voiceItem->voiceId(), trackIt, fragment.first, fragment.second);
-					compositionLength = std::max(compositionLength, fragmentItem->fragmentOffset() + fragmentItem->fragmentLength());
+					const auto& lastFragment = *trackData->_fragments.rbegin();
+					compositionLength = std::max(compositionLength, lastFragment.first + CompositionModel::fragmentLength(*lastFragment.second));
 				}
 			}
 		}
 
-		_timelineItem->setCompositionSpeed(_composition->_speed);
+		_timelineItem->setCompositionSpeed(composition->_speed);
 		_timelineItem->setCompositionLength(compositionLength);
 		_timelineItem->setCompositionOffset(0);
 		for (const auto& track : _tracks)
 			track->_background->setTrackLength(compositionLength);
-		_rightBoundItem->setPos(_timelineItem->pos() + _timelineItem->boundingRect().topRight());
 		_addVoiceItem->setIndex(_voices.size());
 		_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
-		_cursorItem->setTrackCount(_tracks.size());
-		_cursorItem->setVisible(false);
+		_cursorVisible = false;
+		emit cursorChanged();
 
 		setVoiceColumnWidth(requiredVoiceColumnWidth());
 		updateLoop();
@@ -343,7 +444,9 @@ void CompositionScene::reset(const std::shared_ptr<seir::synth::CompositionData>
 			addItem(i->get());
 		addItem(_addVoiceItem.get());
 		addItem(_compositionItem.get());
+		updateFragmentItems();
 	}
+	emit layoutChanged();
 	if (_selectedVoiceId || _selectedTrackId || _selectedSequenceId || _selectedFragmentOffset)
 	{
 		_selectedVoiceId = nullptr;
@@ -379,34 +482,97 @@ float CompositionScene::selectedTrackWeight() const
 	if (!_selectedTrackId)
 		return 1.f;
 	assert(_selectedVoiceId);
-	const auto partIt = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [this](const auto& partData) { return partData->_voice.get() == _selectedVoiceId; });
-	assert(partIt != _composition->_parts.cend());
-	const auto trackIt = std::find_if((*partIt)->_tracks.cbegin(), (*partIt)->_tracks.cend(), [this](const auto& trackData) { return trackData.get() == _selectedTrackId; });
-	assert(trackIt != (*partIt)->_tracks.cend());
-	unsigned totalWeight = 0;
-	for (const auto& part : _composition->_parts)
-		totalWeight = std::accumulate(part->_tracks.begin(), part->_tracks.end(), totalWeight, [](unsigned weight, const auto& trackData) { return weight + trackData->_properties->_weight; });
-	return static_cast<float>((*trackIt)->_properties->_weight) / totalWeight;
+	return _model.trackWeight(_selectedTrackId);
 }
 
 QRectF CompositionScene::setCurrentStep(double step)
 {
-	// Moving cursor leaves artifacts if the view is being scrolled.
-	// The moved-from area should be updated to clean them up.
-	const auto updateRect = _cursorItem->mapRectToScene(_cursorItem->boundingRect());
-	_cursorItem->setPos(step * kStepWidth, -kTimelineHeight);
-	update(updateRect);
-	return _cursorItem->sceneBoundingRect();
+	// The cursor isn't a scene item, so moving it doesn't invalidate the scene.
+	_currentStep = step;
+	emit cursorChanged();
+	return cursorRect();
 }
 
 void CompositionScene::setSpeed(unsigned speed)
 {
 	_timelineItem->setCompositionSpeed(speed);
+	updateWaveforms();
+}
+
+void CompositionScene::setStepWidth(qreal width)
+{
+	if (width == _stepWidth)
+		return;
+	_stepWidth = width;
+	_layouts.clear();
+	for (const auto& track : _tracks)
+	{
+		track->_background->setStepWidth(width);
+		if (track->_waveform)
+			track->_waveform->setStepWidth(width);
+		const auto y = track->_index * kTrackHeight;
+		for (const auto& fragment : track->_fragments)
+		{
+			const auto sequenceIt = track->_data->_fragments.find(fragment.first);
+			assert(sequenceIt != track->_data->_fragments.end());
+			fragment.second->setPos(fragment.first * width, y);
+			fragment.second->setLayout(sequenceLayout(sequenceIt->second));
+		}
+	}
+	_timelineItem->setStepWidth(width);
+	_loopItem->setStepWidth(width);
+	if (const auto& composition = _model.composition())
+		_loopItem->setPos(composition->_loopOffset * width, _tracks.size() * kTrackHeight + kLoopItemOffset);
+	emit cursorChanged();
+	updateSceneRect(_timelineItem->compositionLength());
+	updateFragmentItems();
+}
+
+void CompositionScene::setVisibleRect(const QRectF& rect)
+{
+	_visibleRect = rect;
+	if (!_model.composition())
+		return;
+	// The composition is extended by whole seconds to reach a view width past the visible area,
+	// so that there is always something to scroll to, and scrolling extends it once per view width.
+	if (const auto requiredLength = static_cast<size_t>(std::ceil(std::max(rect.right() + rect.width() - _voiceColumnWidth, qreal{ 0 }) / _stepWidth)); requiredLength > _timelineItem->compositionLength())
+	{
+		const auto speed = _timelineItem->compositionSpeed();
+		setCompositionLength((requiredLength + speed - 1) / speed * speed);
+	}
+	const auto [firstStep, lastStep] = ::itemRange(rect.left() - _voiceColumnWidth, rect.right() - _voiceColumnWidth, _stepWidth);
+	const auto [firstTrack, lastTrack] = ::itemRange(rect.top() - kCompositionHeaderHeight, rect.bottom() - kCompositionHeaderHeight, kTrackHeight);
+	if (firstStep < _firstPopulatedStep || lastStep > _lastPopulatedStep || firstTrack < _firstPopulatedTrack || lastTrack > _lastPopulatedTrack)
+		updateFragmentItems();
+}
+
+void CompositionScene::setWaveformsVisible(bool visible)
+{
+	if (visible == _waveformsVisible)
+		return;
+	_waveformsVisible = visible;
+	if (!visible)
+	{
+		for (const auto& track : _tracks)
+			delete std::exchange(track->_waveform, nullptr);
+		return;
+	}
+	if (!_waveformAnalyzer)
+	{
+		_waveformAnalyzer = new WaveformAnalyzer{ this };
+		connect(_waveformAnalyzer, &WaveformAnalyzer::envelopeReady, this, [this](const void* trackId, const std::shared_ptr<const TrackEnvelope>& envelope) {
+			if (const auto i = _trackIds.find(trackId); i != _trackIds.end() && i->second->_waveform)
+				i->second->_waveform->setEnvelope(envelope);
+		});
+	}
+	for (const auto& track : _tracks)
+		addWaveformItem(*track);
 }
 
 void CompositionScene::showCursor(bool visible)
 {
-	_cursorItem->setVisible(visible);
+	_cursorVisible = visible;
+	emit cursorChanged();
 }
 
 size_t CompositionScene::startOffset() const
@@ -416,82 +582,125 @@ size_t CompositionScene::startOffset() const
 
 void CompositionScene::updateLoop()
 {
-	_loopItem->setLoopLength(_composition->_loopLength);
-	_loopItem->setPos(_composition->_loopOffset * kStepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
-	_loopItem->setVisible(_composition->_loopLength > 0);
+	_loopItem->setLoopLength(_model.composition()->_loopLength);
+	_loopItem->setPos(_model.composition()->_loopOffset * _stepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
+	_loopItem->setVisible(_model.composition()->_loopLength > 0);
 }
 
 void CompositionScene::updateSelectedSequence(const std::shared_ptr<seir::synth::SequenceData>& sequence)
 {
 	assert(_selectedTrackId);
-	const auto trackIt = std::find_if(_tracks.begin(), _tracks.end(), [this](const auto& trackPtr) { return trackPtr->_background->trackId() == _selectedTrackId; });
-	assert(trackIt != _tracks.end());
-	const auto texts = makeSequenceTexts(*sequence);
-	for (const auto& fragment : (*trackIt)->_fragments)
-		if (fragment.second->sequenceId() == sequence.get())
-			fragment.second->setSequence(texts);
+	updateSequence(_selectedTrackId, sequence);
+}
+
+void CompositionScene::updateSequence(const void* trackId, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+{
+	auto& track = **findTrack(trackId);
+	_layouts.erase(sequence.get());
+	const auto& layout = sequenceLayout(sequence);
+	const auto offsetsIt = track._sequenceOffsets.find(sequence.get());
+	if (offsetsIt != track._sequenceOffsets.end())
+	{
+		// Only the fragments which may reach into the populated area can have items.
+		const auto& offsets = offsetsIt->second;
+		const auto firstOffset = _firstPopulatedStep > track._maxFragmentLength ? _firstPopulatedStep - track._maxFragmentLength : 0;
+		for (auto i = offsets.lower_bound(firstOffset); i != offsets.end() && *i < _lastPopulatedStep; ++i)
+			if (const auto fragmentIt = track._fragments.find(*i); fragmentIt != track._fragments.end())
+				fragmentIt->second->setLayout(layout);
+	}
+	scheduleWaveformUpdate(track);
+	// A longer sequence may reach into the populated area from outside of it.
+	if (const auto length = CompositionModel::fragmentLength(*sequence); length > track._maxFragmentLength)
+	{
+		track._maxFragmentLength = length;
+		updateFragmentItems();
+	}
+	// The fragments of the sequence are reported as a single range which covers both their old and new lengths.
+	if (offsetsIt != track._sequenceOffsets.end())
+	{
+		const auto& offsets = offsetsIt->second;
+		emit fragmentsChanged(track._index, *offsets.begin(), *offsets.rbegin() - *offsets.begin() + track._maxFragmentLength);
+	}
 }
 
 void CompositionScene::updateVoice(const void* id, const std::string& name)
 {
-	const auto voiceIt = std::find_if(_voices.cbegin(), _voices.cend(), [id](const auto& voiceItem) { return voiceItem->voiceId() == id; });
-	assert(voiceIt != _voices.cend());
-	(*voiceIt)->setVoiceName(QString::fromStdString(name));
+	const auto voiceIt = _voiceIds.find(id);
+	assert(voiceIt != _voiceIds.end());
+	voiceIt->second->setVoiceName(QString::fromStdString(name));
 	if (const auto width = requiredVoiceColumnWidth(); width != _voiceColumnWidth)
 	{
 		_voiceColumnWidth = width;
 		updateSceneRect(_timelineItem->compositionLength());
 		setVoiceColumnWidth(width);
+		updateFragmentItems();
 	}
 }
 
+void CompositionScene::updateWaveforms()
+{
+	for (const auto& track : _tracks)
+		scheduleWaveformUpdate(*track);
+}
+
 void CompositionScene::setCompositionLength(size_t length)
 {
 	updateSceneRect(length);
 	_timelineItem->setCompositionLength(length);
-	for (const auto& track : _tracks)
-		track->_background->setTrackLength(length);
-	_rightBoundItem->setPos(_timelineItem->pos() + _timelineItem->boundingRect().topRight());
+	// The other tracks are updated when they become populated.
+	std::for_each(_tracks.begin() + std::min(_firstPopulatedTrack, _tracks.size()), _tracks.begin() + std::min(_lastPopulatedTrack, _tracks.size()), [length](const auto& track) { track->_background->setTrackLength(length); });
 }
 
-FragmentItem* CompositionScene::addFragmentItem(const void* voiceId, TrackIterator trackIt, size_t offset, const std::shared_ptr<seir::synth::SequenceData>& sequence)
+FragmentItem* CompositionScene::acquireFragmentItem(TrackIterator trackIt, size_t offset, const std::shared_ptr<seir::synth::SequenceData>& sequence)
 {
-	const auto trackIndex = (*trackIt)->_background->trackIndex();
-	const auto item = new FragmentItem{ trackIndex, offset, sequence.get(), _compositionItem.get() };
-	item->setHighlighted(sequence.get() == _selectedSequenceId, false);
-	item->setPos(offset * kStepWidth, trackIndex * kTrackHeight);
-	item->setSequence(makeSequenceTexts(*sequence));
-	connect(item, &FragmentItem::fragmentMenuRequested, [this, voiceId, trackId = (*trackIt)->_background->trackId()](size_t offset, const QPoint& pos) {
-		emit fragmentMenuRequested(voiceId, trackId, offset, pos);
-	});
-	connect(item, &FragmentItem::fragmentSelected, [this, voiceId, trackId = (*trackIt)->_background->trackId()](const void* sequenceId, size_t offset) { selectFragment(voiceId, trackId, sequenceId, offset); });
-	const auto fragmentIt = (*trackIt)->_fragments.emplace(offset, item).first;
-	if (const auto nextFragmentIt = std::next(fragmentIt); nextFragmentIt != (*trackIt)->_fragments.end())
-		fragmentIt->second->stackBefore(nextFragmentIt->second);
-	else if (const auto nextFragmentTrackIt = std::find_if(std::next(trackIt), _tracks.end(), [](const auto& trackPtr) { return !trackPtr->_fragments.empty(); }); nextFragmentTrackIt != _tracks.end())
-		fragmentIt->second->stackBefore((*nextFragmentTrackIt)->_fragments.cbegin()->second);
+	FragmentItem* item = nullptr;
+	if (_fragmentPool.empty())
+	{
+		item = new FragmentItem{ _compositionItem.get() };
+		connect(item, &FragmentItem::fragmentMenuRequested, [this](const void* trackId, size_t offset, const QPoint& pos) {
+			emit fragmentMenuRequested((*findTrack(trackId))->_voiceId, trackId, offset, pos);
+		});
+		connect(item, &FragmentItem::fragmentSelected, [this](const void* trackId, const void* sequenceId, size_t offset) {
+			selectFragment((*findTrack(trackId))->_voiceId, trackId, sequenceId, offset);
+		});
+	}
 	else
-		fragmentIt->second->stackBefore(_rightBoundItem);
+	{
+		item = _fragmentPool.back();
+		_fragmentPool.pop_back();
+		item->setVisible(true);
+	}
+	const auto trackId = (*trackIt)->_data.get();
+	const auto trackIndex = (*trackIt)->_index;
+	const auto highlighted = trackId == _selectedTrackId && sequence.get() == _selectedSequenceId;
+	item->setFragment(trackId, trackIndex, offset, sequence.get());
+	item->setHighlighted(highlighted, offset == _selectedFragmentOffset);
+	item->setZValue(::fragmentZValue(offset, highlighted));
+	item->setPos(offset * _stepWidth, trackIndex * kTrackHeight);
+	item->setLayout(sequenceLayout(sequence));
+	(*trackIt)->_fragments.emplace(offset, item);
 	return item;
 }
 
-CompositionScene::TrackIterator CompositionScene::addTrackItem(const void* voiceId, const void* trackId, size_t trackIndex, bool isFirstTrack)
+CompositionScene::TrackIterator CompositionScene::addTrackItem(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>& trackData, size_t trackIndex, bool isFirstTrack)
 {
 	assert(trackIndex <= _tracks.size());
-	const auto trackIt = _tracks.emplace(_tracks.begin() + trackIndex, std::make_unique<Track>(*this));
-	(*trackIt)->_background = new TrackItem{ trackId, _compositionItem.get() };
+	const auto trackIt = _tracks.emplace(_tracks.begin() + trackIndex, std::make_unique<Track>(*this, voiceId, trackData, trackIndex));
+	std::for_each(std::next(trackIt), _tracks.end(), [](const auto& trackPtr) { ++trackPtr->_index; });
+	_trackIds.emplace(trackData.get(), trackIt->get());
+	if (isFirstTrack)
+		_voiceFirstTracks[voiceId] = trackIt->get();
+	(*trackIt)->_background = new TrackItem{ trackData.get(), _compositionItem.get() };
+	(*trackIt)->_background->setZValue(kTrackZValue);
 	(*trackIt)->_background->setFirstTrack(isFirstTrack);
+	(*trackIt)->_background->setStepWidth(_stepWidth);
 	(*trackIt)->_background->setPos(0, trackIndex * kTrackHeight);
 	(*trackIt)->_background->setTrackIndex(trackIndex);
-	if (const auto nextTrackIt = std::next(trackIt); nextTrackIt != _tracks.end())
-		(*trackIt)->_background->stackBefore((*nextTrackIt)->_background);
-	else if (const auto firstFragmentTrackIt = std::find_if(_tracks.begin(), trackIt, [](const auto& trackPtr) { return !trackPtr->_fragments.empty(); }); firstFragmentTrackIt != trackIt)
-		(*trackIt)->_background->stackBefore((*firstFragmentTrackIt)->_fragments.cbegin()->second);
-	else
-		(*trackIt)->_background->stackBefore(_rightBoundItem);
 	connect((*trackIt)->_background, &TrackItem::trackMenuRequested, [this, voiceId](const void* trackId, size_t offset, const QPoint& pos) {
 		emit trackMenuRequested(voiceId, trackId, offset, pos);
 	});
+	if (_waveformsVisible)
+		addWaveformItem(**trackIt);
 	return trackIt;
 }
 
@@ -499,6 +708,7 @@ VoiceItem* CompositionScene::addVoiceItem(const void* id, const QString& name, s
 {
 	const auto voiceIndex = _voices.size();
 	const auto voiceItem = _voices.emplace_back(std::make_unique<VoiceItem>(id)).get();
+	_voiceIds.emplace(id, voiceItem);
 	voiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
 	voiceItem->setTrackCount(trackCount);
 	voiceItem->setVoiceIndex(voiceIndex);
@@ -509,27 +719,50 @@ VoiceItem* CompositionScene::addVoiceItem(const void* id, const QString& name, s
 	return voiceItem;
 }
 
+void CompositionScene::addWaveformItem(Track& track)
+{
+	assert(!track._waveform);
+	track._waveform = new WaveformItem{ _compositionItem.get() };
+	track._waveform->setZValue(kWaveformZValue);
+	track._waveform->setStepWidth(_stepWidth);
+	track._waveform->setPos(0, track._background->trackIndex() * kTrackHeight + kTrackHeight - kWaveformLaneHeight); // Moved along with the background.
+	scheduleWaveformUpdate(track);
+}
+
+CompositionScene::TrackIterator CompositionScene::findTrack(const void* trackId)
+{
+	const auto i = _trackIds.find(trackId);
+	assert(i != _trackIds.end());
+	const auto trackIt = _tracks.begin() + i->second->_index;
+	assert(trackIt->get() == i->second);
+	return trackIt;
+}
+
 void CompositionScene::highlightSequence(const void* trackId, const void* sequenceId, size_t offset)
 {
-	const auto trackIt = std::find_if(_tracks.begin(), _tracks.end(), [trackId](const auto& trackPtr) { return trackPtr->_background->trackId() == trackId; });
-	assert(trackIt != _tracks.end());
+	const auto trackIt = findTrack(trackId);
 	for (const auto& fragment : (*trackIt)->_fragments)
 	{
 		const auto shouldBeHighlighted = fragment.second->sequenceId() == sequenceId;
 		fragment.second->setHighlighted(shouldBeHighlighted, fragment.first == offset);
-		fragment.second->setZValue(shouldBeHighlighted ? kHighlightZValue : kDefaultZValue);
+		fragment.second->setZValue(::fragmentZValue(fragment.first, shouldBeHighlighted));
 	}
 }
 
 void CompositionScene::highlightVoice(const void* id, bool highlight)
 {
-	const auto voiceIt = std::find_if(_voices.begin(), _voices.end(), [id](const auto& voicePtr) { return voicePtr->voiceId() == id; });
-	assert(voiceIt != _voices.end());
-	(*voiceIt)->setHighlighted(highlight);
-	(*voiceIt)->setZValue(highlight ? kHighlightZValue : kDefaultZValue);
+	const auto voiceIt = _voiceIds.find(id);
+	assert(voiceIt != _voiceIds.end());
+	voiceIt->second->setHighlighted(highlight);
+	voiceIt->second->setZValue(highlight ? kHighlightZValue : kDefaultZValue);
+}
+
+bool CompositionScene::isPopulated(size_t trackIndex, size_t offset, size_t length) const noexcept
+{
+	return trackIndex >= _firstPopulatedTrack && trackIndex < _lastPopulatedTrack && offset < _lastPopulatedStep && offset + length > _firstPopulatedStep;
 }
 
-std::vector<FragmentSound> CompositionScene::makeSequenceTexts(const seir::synth::SequenceData& sequence) const
+std::shared_ptr<const FragmentLayout> CompositionScene::makeLayout(const seir::synth::SequenceData& sequence) const
 {
 	std::vector<FragmentSound> result;
 	result.reserve(sequence._sounds.size()); // A reasonable guess.
@@ -543,7 +776,35 @@ std::vector<FragmentSound> CompositionScene::makeSequenceTexts(const seir::synth
 		if (info._extra)
 			result.emplace_back(0, _extraNoteNames[info._base], 0);
 	}
-	return result;
+	return std::make_shared<const FragmentLayout>(std::move(result), _stepWidth);
+}
+
+void CompositionScene::releaseFragmentItem(FragmentItem* item)
+{
+	// The item may be the one whose event is being handled, so it isn't deleted.
+	item->setVisible(false);
+	_fragmentPool.emplace_back(item);
+}
+
+void CompositionScene::scheduleWaveformUpdate(Track& track)
+{
+	if (!_waveformsVisible)
+		return;
+	track._waveformOutdated = true;
+	if (!std::exchange(_waveformUpdateScheduled, true))
+		QTimer::singleShot(0, this, &CompositionScene::updateWaveformItems);
+}
+
+const std::shared_ptr<const FragmentLayout>& CompositionScene::sequenceLayout(const std::shared_ptr<seir::synth::SequenceData>& sequence)
+{
+	// All fragments of a sequence share its layout, which is rebuilt only when the sequence is updated.
+	auto& cached = _layouts[sequence.get()];
+	if (!cached._layout || cached._sequence.expired())
+	{
+		cached._sequence = sequence;
+		cached._layout = makeLayout(*sequence);
+	}
+	return cached._layout;
 }
 
 qreal CompositionScene::requiredVoiceColumnWidth() const
@@ -561,9 +822,94 @@ void CompositionScene::setVoiceColumnWidth(qreal width)
 		voice->setWidth(width);
 	_addVoiceItem->setWidth(width);
 	_compositionItem->setPos(width, kCompositionHeaderHeight);
+	emit cursorChanged();
+}
+
+void CompositionScene::updateFragmentItems()
+{
+	// The populated area extends the visible one by the size of the view in each direction,
+	// so that scrolling within it doesn't require any item changes.
+	const auto marginX = _visibleRect.width();
+	const auto marginY = _visibleRect.height();
+	std::tie(_firstPopulatedStep, _lastPopulatedStep) = ::itemRange(_visibleRect.left() - _voiceColumnWidth - marginX, _visibleRect.right() - _voiceColumnWidth + marginX, _stepWidth);
+	std::tie(_firstPopulatedTrack, _lastPopulatedTrack) = ::itemRange(_visibleRect.top() - kCompositionHeaderHeight - marginY, _visibleRect.bottom() - kCompositionHeaderHeight + marginY, kTrackHeight);
+	for (auto trackIt = _tracks.begin(); trackIt != _tracks.end(); ++trackIt)
+	{
+		auto& track = **trackIt;
+		const auto trackIndex = track._index;
+		for (auto i = track._fragments.begin(); i != track._fragments.end();)
+		{
+			if (isPopulated(trackIndex, i->first, i->second->fragmentLength()))
+				++i;
+			else
+			{
+				releaseFragmentItem(i->second);
+				i = track._fragments.erase(i);
+			}
+		}
+		if (trackIndex < _firstPopulatedTrack || trackIndex >= _lastPopulatedTrack)
+			continue;
+		if (const auto length = _timelineItem->compositionLength(); track._background->trackLength() != length)
+			track._background->setTrackLength(length);
+		const auto firstOffset = _firstPopulatedStep > track._maxFragmentLength ? _firstPopulatedStep - track._maxFragmentLength : 0;
+		for (auto i = track._data->_fragments.lower_bound(firstOffset); i != track._data->_fragments.end() && i->first < _lastPopulatedStep; ++i)
+			if (track._fragments.find(i->first) == track._fragments.end() && isPopulated(trackIndex, i->first, CompositionModel::fragmentLength(*i->second)))
+				acquireFragmentItem(trackIt, i->first, i->second);
+	}
+}
+
+void CompositionScene::updateLayout()
+{
+	if (_transactionDepth > 0)
+	{
+		_layoutPending = true;
+		return;
+	}
+	_layoutPending = false;
+	size_t trackIndex = 0;
+	for (size_t voiceIndex = 0; voiceIndex < _voices.size(); ++voiceIndex)
+	{
+		const auto& voiceItem = _voices[voiceIndex];
+		if (voiceItem->voiceIndex() != voiceIndex)
+			voiceItem->setVoiceIndex(voiceIndex);
+		voiceItem->setPos(0, kCompositionHeaderHeight + trackIndex * kTrackHeight);
+		trackIndex += voiceItem->trackCount();
+	}
+	assert(trackIndex == _tracks.size());
+	for (const auto& track : _tracks)
+		track->updateItems();
+	_addVoiceItem->setIndex(_voices.size());
+	_addVoiceItem->setPos(0, kCompositionHeaderHeight + _tracks.size() * kTrackHeight);
+	emit cursorChanged();
+	_loopItem->setPos(_model.composition()->_loopOffset * _stepWidth, _tracks.size() * kTrackHeight + kLoopItemOffset);
+	updateSceneRect(_timelineItem->compositionLength());
+	updateFragmentItems();
+	emit layoutChanged();
 }
 
 void CompositionScene::updateSceneRect(size_t compositionLength)
 {
-	setSceneRect(0, 0, _voiceColumnWidth + compositionLength * kStepWidth, kCompositionHeaderHeight + _tracks.size() * kTrackHeight + std::max(kAddVoiceItemHeight, kCompositionFooterHeight));
+	setSceneRect(0, 0, _voiceColumnWidth + compositionLength * _stepWidth, kCompositionHeaderHeight + _tracks.size() * kTrackHeight + std::max(kAddVoiceItemHeight, kCompositionFooterHeight));
+}
+
+void CompositionScene::updateWaveformItems()
+{
+	_waveformUpdateScheduled = false;
+	const auto& composition = _model.composition();
+	if (!_waveformsVisible || !composition)
+		return;
+	// The envelopes are scaled to the output level, which depends on the weights of all tracks.
+	const auto gain = composition->_gainDivisor > 0 ? 1 / composition->_gainDivisor : 1.f;
+	for (const auto& track : _tracks)
+	{
+		const auto trackId = track->_data.get();
+		track->_waveform->setGain(_model.trackWeight(trackId) * gain);
+		if (!std::exchange(track->_waveformOutdated, false))
+			continue;
+		// Only the outdated tracks are analyzed, and the unchanged ones are found in the cache.
+		const auto part = _model.trackPart(trackId);
+		assert(part);
+		if (const auto envelope = _waveformAnalyzer->analyze(trackId, *composition, *part, track->_data))
+			track->_waveform->setEnvelope(envelope);
+	}
 }
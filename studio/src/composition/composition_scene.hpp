@@ -6,6 +6,7 @@
 
 #include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <QGraphicsScene>
@@ -14,86 +15,126 @@ class QStaticText;
 
 namespace seir::synth
 {
-	struct CompositionData;
 	struct PartData;
 	struct SequenceData;
+	struct TrackData;
 }
 
 class AddVoiceItem;
 class CompositionItem;
-class CursorItem;
-class ElusiveItem;
+class CompositionModel;
 class FragmentItem;
-struct FragmentSound;
+class FragmentLayout;
 class LoopItem;
 class TimelineItem;
 class VoiceItem;
+class WaveformAnalyzer;
 
 class CompositionScene final : public QGraphicsScene
 {
 	Q_OBJECT
 
 public:
-	explicit CompositionScene(QObject* parent = nullptr);
+	explicit CompositionScene(const CompositionModel&, QObject* parent = nullptr);
 	~CompositionScene() override;
 
-	void addTrack(const void* voiceId, const void* trackId);
+	void addTrack(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>&);
 	void appendPart(const std::shared_ptr<seir::synth::PartData>&);
-	void insertFragment(const void* voiceId, const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>&);
+	void beginTransaction() noexcept; // Structural changes are laid out once, when the outermost transaction is committed.
+	void commitTransaction();
+	QRectF cursorRect() const;
+	void extendCompositionLength();
+	void insertFragment(const void* trackId, size_t offset, const std::shared_ptr<seir::synth::SequenceData>&);
 	void removeFragment(const void* trackId, size_t offset);
 	void removeTrack(const void* voiceId, const void* trackId);
 	void removeVoice(const void* voiceId);
-	void reset(const std::shared_ptr<seir::synth::CompositionData>&, size_t viewWidth);
+	void refreshSelection();
+	void reset();
 	void selectFragment(const void* voiceId, const void* trackId, const void* sequenceId, size_t offset);
 	float selectedTrackWeight() const;
 	QRectF setCurrentStep(double step);
 	void setSpeed(unsigned speed);
+	void setStepWidth(qreal);
+	void setVisibleRect(const QRectF&);
+	void setWaveformsVisible(bool);
 	void showCursor(bool);
+	bool isCursorVisible() const noexcept { return _cursorVisible; }
 	size_t startOffset() const;
+	qreal stepWidth() const noexcept { return _stepWidth; }
+	qreal voiceColumnWidth() const noexcept { return _voiceColumnWidth; }
 	void updateLoop();
 	void updateSelectedSequence(const std::shared_ptr<seir::synth::SequenceData>&);
+	void updateSequence(const void* trackId, const std::shared_ptr<seir::synth::SequenceData>&);
 	void updateVoice(const void* id, const std::string& name);
+	void updateWaveforms(); // Analyzes the tracks again if the changes which affect all of them were made outside of the scene.
 
 signals:
+	void cursorChanged();
 	void loopMenuRequested(const QPoint& pos);
 	void newVoiceRequested();
 	void fragmentMenuRequested(const void* voiceId, const void* trackId, size_t offset, const QPoint& pos);
 	void fragmentSelected(const void* voiceId, const void* trackId, const void* sequenceId, size_t offset);
+	void fragmentsChanged(size_t trackIndex, size_t offset, size_t length); // The fragments of the track within the range may have changed.
+	void layoutChanged();                                                   // Tracks may have been added, removed or moved.
 	void timelineMenuRequested(size_t step, const QPoint& pos);
 	void trackMenuRequested(const void* voiceId, const void* trackId, size_t offset, const QPoint& pos);
 	void voiceActionRequested(const void* voiceId);
 	void voiceMenuRequested(const void* voiceId, const QPoint& pos);
 
-private slots:
-	void setCompositionLength(size_t length);
-
 private:
+	struct CachedLayout;
 	struct Track;
 	using TrackIterator = std::vector<std::unique_ptr<Track>>::iterator;
 
-	FragmentItem* addFragmentItem(const void* voiceId, TrackIterator, size_t offset, const std::shared_ptr<seir::synth::SequenceData>&);
-	TrackIterator addTrackItem(const void* voiceId, const void* trackId, size_t trackIndex, bool isFirstTrack);
+	FragmentItem* acquireFragmentItem(TrackIterator, size_t offset, const std::shared_ptr<seir::synth::SequenceData>&);
+	TrackIterator addTrackItem(const void* voiceId, const std::shared_ptr<seir::synth::TrackData>&, size_t trackIndex, bool isFirstTrack);
 	VoiceItem* addVoiceItem(const void* id, const QString& name, size_t trackCount);
+	void addWaveformItem(Track&);
+	TrackIterator findTrack(const void* trackId);
 	void highlightSequence(const void* trackId, const void* sequenceId, size_t offset);
 	void highlightVoice(const void* id, bool highlight);
-	std::vector<FragmentSound> makeSequenceTexts(const seir::synth::SequenceData&) const;
+	bool isPopulated(size_t trackIndex, size_t offset, size_t length) const noexcept;
+	std::shared_ptr<const FragmentLayout> makeLayout(const seir::synth::SequenceData&) const;
+	void releaseFragmentItem(FragmentItem*);
+	void scheduleWaveformUpdate(Track&);
+	const std::shared_ptr<const FragmentLayout>& sequenceLayout(const std::shared_ptr<seir::synth::SequenceData>&);
 	qreal requiredVoiceColumnWidth() const;
+	void setCompositionLength(size_t length);
 	void setVoiceColumnWidth(qreal);
+	void updateFragmentItems();
+	void updateLayout();
 	void updateSceneRect(size_t compositionLength);
+	void updateWaveformItems();
 
 private:
-	std::shared_ptr<seir::synth::CompositionData> _composition;
+	const CompositionModel& _model;
 	std::vector<std::unique_ptr<VoiceItem>> _voices;
+	std::unordered_map<const void*, VoiceItem*> _voiceIds;
+	std::unordered_map<const void*, Track*> _voiceFirstTracks; // The index of the first track is the first track row of the voice.
 	std::unique_ptr<AddVoiceItem> _addVoiceItem;
 	std::unique_ptr<CompositionItem> _compositionItem;
 	TimelineItem* const _timelineItem;
-	ElusiveItem* const _rightBoundItem;
-	CursorItem* const _cursorItem;
 	LoopItem* const _loopItem;
 	std::vector<std::unique_ptr<Track>> _tracks;
+	std::unordered_map<const void*, Track*> _trackIds;
+	std::vector<FragmentItem*> _fragmentPool; // Hidden items ready to be reused.
+	std::unordered_map<const void*, CachedLayout> _layouts;
+	QRectF _visibleRect;
+	size_t _firstPopulatedStep = 0; // Fragment items exist only for the populated area around the visible one.
+	size_t _lastPopulatedStep = 0;
+	size_t _firstPopulatedTrack = 0;
+	size_t _lastPopulatedTrack = 0;
 	std::array<std::shared_ptr<QStaticText>, 7 * 10> _baseNoteNames; // C0, D0, ..., C1, D1, ...
 	std::array<std::shared_ptr<QStaticText>, 7> _extraNoteNames;     // C#, D#, ...
 	qreal _voiceColumnWidth;
+	qreal _stepWidth;
+	double _currentStep = 0;
+	bool _cursorVisible = false;
+	WaveformAnalyzer* _waveformAnalyzer = nullptr; // Created when the waveforms are shown for the first time.
+	bool _waveformsVisible = false;
+	bool _waveformUpdateScheduled = false; // Edits are analyzed once per event loop iteration.
+	size_t _transactionDepth = 0;
+	bool _layoutPending = false;
 	const void* _selectedVoiceId = nullptr;
 	const void* _selectedTrackId = nullptr;
 	const void* _selectedSequenceId = nullptr;
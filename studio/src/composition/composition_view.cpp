@@ -0,0 +1,93 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "composition_view.hpp"
+
+#include "../theme.hpp"
+#include "composition_scene.hpp"
+
+#include <QPaintEvent>
+#include <QPainter>
+
+CompositionView::CompositionView(CompositionScene* scene, QWidget* parent)
+	: QGraphicsView{ scene, parent }
+	, _scene{ scene }
+{
+	// Once the signal is connected, the scene reports all its changes through it.
+	connect(_scene, &QGraphicsScene::changed, this, &CompositionView::invalidateCache);
+	// The scene may move relative to the viewport without any of its items changing.
+	connect(_scene, &QGraphicsScene::sceneRectChanged, this, [this] { invalidateCache({}); });
+	connect(_scene, &CompositionScene::cursorChanged, this, &CompositionView::updateCursor);
+}
+
+QRectF CompositionView::cursorViewportRect() const
+{
+	return { mapFromScene(_cursorSceneRect.topLeft()), _cursorSceneRect.size() };
+}
+
+void CompositionView::invalidateCache(const QList<QRectF>& sceneRects)
+{
+	if (sceneRects.isEmpty())
+		_dirtyRegion = viewport()->rect();
+	else
+		for (const auto& rect : sceneRects)
+			_dirtyRegion += mapFromScene(rect).boundingRect().adjusted(-2, -2, 2, 2); // The same margin QGraphicsView uses for antialiasing.
+	viewport()->update(_dirtyRegion);
+}
+
+void CompositionView::paintEvent(QPaintEvent* e)
+{
+	const auto devicePixelRatio = viewport()->devicePixelRatioF();
+	if (const auto cacheSize = viewport()->size() * devicePixelRatio; _cache.size() != cacheSize || _cache.devicePixelRatio() != devicePixelRatio)
+	{
+		_cache = QPixmap{ cacheSize };
+		_cache.setDevicePixelRatio(devicePixelRatio);
+		_dirtyRegion = viewport()->rect();
+	}
+	_dirtyRegion &= viewport()->rect();
+	if (!_dirtyRegion.isEmpty())
+	{
+		QPainter painter{ &_cache };
+		for (const auto& rect : _dirtyRegion)
+			render(&painter, rect, rect, Qt::IgnoreAspectRatio);
+		_dirtyRegion = {};
+	}
+
+	QPainter painter{ viewport() };
+	for (const auto& rect : e->region())
+		painter.drawPixmap(QRectF{ rect }, _cache, QRectF{ QPointF{ rect.topLeft() } * devicePixelRatio, QSizeF{ rect.size() } * devicePixelRatio });
+	if (_cursorVisible)
+	{
+		painter.setPen(kCursorColors._pen);
+		painter.setBrush(kCursorColors._brush);
+		painter.drawRect(cursorViewportRect());
+	}
+}
+
+void CompositionView::scrollContentsBy(int dx, int dy)
+{
+	QGraphicsView::scrollContentsBy(dx, dy);
+	// The cache is scrolled along with the viewport, so only the exposed part has to be rendered.
+	if (!_cache.isNull())
+	{
+		const auto devicePixelRatio = _cache.devicePixelRatio();
+		_cache.scroll(qRound(dx * devicePixelRatio), qRound(dy * devicePixelRatio), _cache.rect());
+	}
+	const QRegion viewportRegion{ viewport()->rect() };
+	_dirtyRegion.translate(dx, dy);
+	_dirtyRegion += viewportRegion.subtracted(viewportRegion.translated(dx, dy));
+	viewport()->update(); // The cursor has been scrolled together with the contents.
+}
+
+void CompositionView::updateCursor()
+{
+	const auto updateCursorRect = [this] {
+		if (_cursorVisible)
+			viewport()->update(cursorViewportRect().toAlignedRect().adjusted(-1, -1, 1, 1));
+	};
+	updateCursorRect();
+	_cursorSceneRect = _scene->cursorRect();
+	_cursorVisible = _scene->isCursorVisible();
+	updateCursorRect();
+}
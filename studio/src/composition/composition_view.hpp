@@ -0,0 +1,33 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <QGraphicsView>
+
+class CompositionScene;
+
+// Keeps the rendered scene in a pixmap and draws the playback cursor over it,
+// so that moving the cursor doesn't require the scene to be rendered again.
+class CompositionView final : public QGraphicsView
+{
+	Q_OBJECT
+
+public:
+	CompositionView(CompositionScene*, QWidget* parent);
+
+private:
+	QRectF cursorViewportRect() const;
+	void invalidateCache(const QList<QRectF>& sceneRects);
+	void paintEvent(QPaintEvent*) override;
+	void scrollContentsBy(int dx, int dy) override;
+	void updateCursor();
+
+private:
+	CompositionScene* const _scene;
+	QPixmap _cache;
+	QRegion _dirtyRegion; // The part of the cache that doesn't match the scene, in viewport coordinates.
+	QRectF _cursorSceneRect;
+	bool _cursorVisible = false;
+};
@@ -5,20 +5,27 @@
 #include "composition_widget.hpp"
 
 #include "../theme.hpp"
+#include "composition_minimap.hpp"
 #include "composition_scene.hpp"
+#include "composition_view.hpp"
 #include "voice_editor.hpp"
 
 #include <seir_synth/data.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <utility>
 
-#include <QGraphicsView>
 #include <QGridLayout>
 #include <QMenu>
 #include <QMessageBox>
 #include <QScrollBar>
 #include <QStyle>
 #include <QToolButton>
+#include <QWheelEvent>
 
 namespace
 {
@@ -61,20 +68,44 @@ namespace
 		}
 		return result;
 	}
+
+	bool haveSameSounds(const seir::synth::SequenceData& first, const seir::synth::SequenceData& second)
+	{
+		return std::equal(first._sounds.cbegin(), first._sounds.cend(), second._sounds.cbegin(), second._sounds.cend(), [](const seir::synth::Sound& a, const seir::synth::Sound& b) {
+			return a._delay == b._delay && a._note == b._note && a._sustain == b._sustain;
+		});
+	}
 }
 
 CompositionWidget::CompositionWidget(QWidget* parent)
 	: QWidget{ parent }
 	, _voiceEditor{ std::make_unique<VoiceEditor>(this) }
-	, _scene{ new CompositionScene{ this } }
+	, _scene{ new CompositionScene{ _model, this } }
 {
 	const auto layout = new QGridLayout{ this };
 	layout->setContentsMargins({});
 
-	_view = new QGraphicsView{ _scene, this };
+	_view = new CompositionView{ _scene, this };
 	_view->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
 	layout->addWidget(_view, 0, 0, 3, 1);
 
+	// The minimap must exist before the visible rect is updated for the first time.
+	_minimap = new CompositionMinimap{ _model, this };
+	_minimap->setVisible(false);
+	layout->addWidget(_minimap, 3, 0, 1, 2);
+	connect(_scene, &CompositionScene::fragmentsChanged, _minimap, &CompositionMinimap::invalidateFragments);
+	connect(_scene, &CompositionScene::layoutChanged, _minimap, &CompositionMinimap::invalidate);
+	connect(_minimap, &CompositionMinimap::positionRequested, [this](const QPointF& position) {
+		_view->centerOn(_scene->voiceColumnWidth() + position.x() * _scene->stepWidth(), kCompositionHeaderHeight + position.y() * kTrackHeight);
+	});
+
+	_view->viewport()->installEventFilter(this);
+	for (const auto scrollBar : { _view->horizontalScrollBar(), _view->verticalScrollBar() })
+	{
+		connect(scrollBar, &QScrollBar::valueChanged, this, &CompositionWidget::updateVisibleRect);
+		connect(scrollBar, &QScrollBar::rangeChanged, this, &CompositionWidget::updateVisibleRect);
+	}
+
 	const auto rightButton = new QToolButton{ this };
 	rightButton->setEnabled(false);
 	rightButton->setIcon(style()->standardIcon(QStyle::SP_ArrowRight));
@@ -88,29 +119,25 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 	layout->addWidget(leftButton, 1, 1);
 
 	connect(_scene, &CompositionScene::fragmentMenuRequested, [this](const void* voiceId, const void* trackId, size_t offset, const QPoint& pos) {
-		const auto part = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [voiceId](const auto& partData) { return partData->_voice.get() == voiceId; });
-		assert(part != _composition->_parts.cend());
-		const auto track = std::find_if((*part)->_tracks.cbegin(), (*part)->_tracks.cend(), [trackId](const auto& trackData) { return trackData.get() == trackId; });
-		assert(track != (*part)->_tracks.cend());
-		const auto fragment = (*track)->_fragments.find(offset);
-		assert(fragment != (*track)->_fragments.end());
+		const auto part = _model.part(voiceId);
+		assert(part);
+		assert(_model.trackPart(trackId) == part);
 		QMenu menu;
 		const auto removeFragmentAction = menu.addAction(tr("Remove fragment"));
 		menu.addSeparator();
 		const auto removeTrackAction = menu.addAction(tr("Remove track"));
-		removeTrackAction->setEnabled((*part)->_tracks.size() > 1);
+		removeTrackAction->setEnabled(part->_tracks.size() > 1);
 		if (const auto action = menu.exec(pos); action == removeFragmentAction)
 		{
 			_scene->removeFragment(trackId, offset);
-			(*track)->_fragments.erase(fragment);
+			_model.removeFragment(trackId, offset);
 		}
 		else if (action == removeTrackAction)
 		{
-			if (const auto message = tr("Remove %1 track %2?").arg("<b>" + QString::fromStdString((*part)->_voiceName) + "</b>").arg(track - (*part)->_tracks.cbegin() + 1);
-				QMessageBox::question(this, {}, message, QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+			if (!confirmTrackRemoval(*part, trackId))
 				return;
 			_scene->removeTrack(voiceId, trackId);
-			(*part)->_tracks.erase(track);
+			_model.removeTrack(trackId);
 		}
 		else
 			return;
@@ -121,8 +148,8 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 		menu.addAction(tr("Remove loop"));
 		if (const auto action = menu.exec(pos))
 		{
-			_composition->_loopOffset = 0;
-			_composition->_loopLength = 0;
+			_model.composition()->_loopOffset = 0;
+			_model.composition()->_loopLength = 0;
 		}
 		else
 			return;
@@ -133,9 +160,10 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 		_voiceEditor->setVoiceName(tr("NewVoice").toStdString());
 		if (_voiceEditor->exec() != QDialog::Accepted)
 			return;
-		const auto& part = _composition->_parts.emplace_back(std::make_shared<seir::synth::PartData>(::makeDefaultVoice()));
+		const auto part = std::make_shared<seir::synth::PartData>(::makeDefaultVoice());
 		part->_voiceName = _voiceEditor->voiceName();
 		part->_tracks.emplace_back(std::make_shared<seir::synth::TrackData>(std::make_shared<seir::synth::TrackProperties>()));
+		_model.appendPart(part);
 		_scene->appendPart(part);
 		_view->horizontalScrollBar()->setValue(_view->horizontalScrollBar()->minimum());
 		emit compositionChanged();
@@ -148,26 +176,25 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 		bool canMoveLeft = false;
 		if (voiceId)
 		{
-			const auto partIt = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [voiceId](const auto& partData) { return partData->_voice.get() == voiceId; });
-			assert(partIt != _composition->_parts.cend());
-			voice = (*partIt)->_voice;
+			const auto part = _model.part(voiceId);
+			assert(part);
+			voice = part->_voice;
 			if (trackId)
 			{
-				const auto trackIt = std::find_if((*partIt)->_tracks.cbegin(), (*partIt)->_tracks.cend(), [trackId](const auto& trackData) { return trackData.get() == trackId; });
-				assert(trackIt != (*partIt)->_tracks.cend());
-				track = *trackIt;
+				track = _model.track(trackId);
+				assert(track);
+				assert(_model.trackPart(trackId) == part);
 				if (sequenceId)
 				{
-					const auto sequenceIt = std::find_if((*trackIt)->_sequences.cbegin(), (*trackIt)->_sequences.cend(), [sequenceId](const auto& sequenceData) { return sequenceData.get() == sequenceId; });
-					assert(sequenceIt != (*trackIt)->_sequences.end());
-					sequence = *sequenceIt;
-					const auto fragmentIt = (*trackIt)->_fragments.find(offset);
-					assert(fragmentIt != (*trackIt)->_fragments.end());
-					if (const auto nextFragmentIt = std::next(fragmentIt); nextFragmentIt != (*trackIt)->_fragments.end())
+					sequence = _model.sequence(sequenceId);
+					assert(sequence);
+					const auto fragmentIt = track->_fragments.find(offset);
+					assert(fragmentIt != track->_fragments.end());
+					if (const auto nextFragmentIt = std::next(fragmentIt); nextFragmentIt != track->_fragments.end())
 						canMoveRight = nextFragmentIt->first != offset + 1;
 					else
 						canMoveRight = true;
-					canMoveLeft = offset > 0 && !(fragmentIt != (*trackIt)->_fragments.begin() && std::prev(fragmentIt)->first == offset - 1);
+					canMoveLeft = offset > 0 && !(fragmentIt != track->_fragments.begin() && std::prev(fragmentIt)->first == offset - 1);
 				}
 			}
 		}
@@ -176,77 +203,77 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 		emit selectionChanged(voice, track, sequence);
 	});
 	connect(_scene, &CompositionScene::timelineMenuRequested, [this](size_t step, const QPoint& pos) {
-		const auto loopEnd = size_t{ _composition->_loopOffset } + _composition->_loopLength;
+		const auto& composition = _model.composition();
+		const auto loopEnd = size_t{ composition->_loopOffset } + composition->_loopLength;
 		QMenu menu;
 		const auto beginAction = menu.addAction(tr("Begin loop here"));
 		beginAction->setEnabled(step < loopEnd);
 		const auto endAction = menu.addAction(tr("End loop here"));
-		endAction->setEnabled(step >= _composition->_loopOffset);
+		endAction->setEnabled(step >= composition->_loopOffset);
 		if (const auto action = menu.exec(pos); action == beginAction)
 		{
-			_composition->_loopOffset = static_cast<unsigned>(step);
-			_composition->_loopLength = static_cast<unsigned>(loopEnd - step);
+			composition->_loopOffset = static_cast<unsigned>(step);
+			composition->_loopLength = static_cast<unsigned>(loopEnd - step);
 		}
 		else if (action == endAction)
-			_composition->_loopLength = static_cast<unsigned>(step - _composition->_loopOffset + 1);
+			composition->_loopLength = static_cast<unsigned>(step - composition->_loopOffset + 1);
 		else
 			return;
 		_scene->updateLoop();
 		emit compositionChanged();
 	});
 	connect(_scene, &CompositionScene::trackMenuRequested, [this](const void* voiceId, const void* trackId, size_t offset, const QPoint& pos) {
-		const auto part = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [voiceId](const auto& partData) { return partData->_voice.get() == voiceId; });
-		assert(part != _composition->_parts.cend());
-		const auto track = std::find_if((*part)->_tracks.cbegin(), (*part)->_tracks.cend(), [trackId](const auto& trackData) { return trackData.get() == trackId; });
-		assert(track != (*part)->_tracks.cend());
+		const auto part = _model.part(voiceId);
+		assert(part);
+		const auto track = _model.track(trackId);
+		assert(track);
 		QMenu menu;
 		const auto insertSubmenu = menu.addMenu(tr("Insert sequence"));
-		const auto sequenceCount = (*track)->_sequences.size();
+		const auto sequenceCount = track->_sequences.size();
 		for (size_t sequenceIndex = 0; sequenceIndex < sequenceCount; ++sequenceIndex)
-			insertSubmenu->addAction(::makeSequenceName(*(*track)->_sequences[sequenceIndex]))->setData(static_cast<unsigned>(sequenceIndex));
-		if (!(*track)->_sequences.empty())
+			insertSubmenu->addAction(::makeSequenceName(*track->_sequences[sequenceIndex]))->setData(static_cast<unsigned>(sequenceIndex));
+		if (!track->_sequences.empty())
 			insertSubmenu->addSeparator();
 		const auto newSequenceAction = insertSubmenu->addAction(tr("New sequence..."));
 		const auto removeTrackAction = menu.addAction(tr("Remove track"));
-		removeTrackAction->setEnabled((*part)->_tracks.size() > 1);
+		removeTrackAction->setEnabled(part->_tracks.size() > 1);
 		if (const auto action = menu.exec(pos); action == newSequenceAction)
 		{
 			const auto sequence = std::make_shared<seir::synth::SequenceData>();
-			(*track)->_sequences.emplace_back(sequence);
-			[[maybe_unused]] const auto inserted = (*track)->_fragments.insert_or_assign(offset, sequence).second;
+			_model.addSequence(trackId, sequence);
+			[[maybe_unused]] const auto inserted = _model.insertFragment(trackId, offset, sequence);
 			assert(inserted);
-			_scene->insertFragment(voiceId, trackId, offset, sequence);
+			_scene->insertFragment(trackId, offset, sequence);
 			_scene->selectFragment(voiceId, trackId, sequence.get(), offset);
 		}
 		else if (action == removeTrackAction)
 		{
-			if (const auto message = tr("Remove %1 track %2?").arg("<b>" + QString::fromStdString((*part)->_voiceName) + "</b>").arg(track - (*part)->_tracks.cbegin() + 1);
-				QMessageBox::question(this, {}, message, QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+			if (!confirmTrackRemoval(*part, trackId))
 				return;
 			_scene->removeTrack(voiceId, trackId);
-			(*part)->_tracks.erase(track);
+			_model.removeTrack(trackId);
 		}
 		else if (action)
 		{
-			const auto& sequence = (*track)->_sequences[action->data().toUInt()];
-			[[maybe_unused]] const auto inserted = (*track)->_fragments.insert_or_assign(offset, sequence).second;
+			const auto sequence = track->_sequences[action->data().toUInt()];
+			[[maybe_unused]] const auto inserted = _model.insertFragment(trackId, offset, sequence);
 			assert(inserted);
-			_scene->insertFragment(voiceId, trackId, offset, sequence);
+			_scene->insertFragment(trackId, offset, sequence);
 		}
 		else
 			return;
 		emit compositionChanged();
 	});
 	connect(_scene, &CompositionScene::voiceActionRequested, [this](const void* voiceId) {
-		const auto part = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [voiceId](const auto& partData) { return partData->_voice.get() == voiceId; });
-		assert(part != _composition->_parts.cend());
-		if (!editVoiceName(voiceId, (*part)->_voiceName))
+		const auto part = _model.part(voiceId);
+		assert(part);
+		if (!editVoiceName(voiceId, part->_voiceName))
 			return;
 		emit compositionChanged();
 	});
 	connect(_scene, &CompositionScene::voiceMenuRequested, [this](const void* voiceId, const QPoint& pos) {
-		const auto part = std::find_if(_composition->_parts.cbegin(), _composition->_parts.cend(), [voiceId](const auto& partData) { return partData->_voice.get() == voiceId; });
-		assert(part != _composition->_parts.cend());
+		const auto part = _model.part(voiceId);
+		assert(part);
 		QMenu menu;
 		const auto editVoiceAction = menu.addAction(tr("Rename voice..."));
 		editVoiceAction->setFont(::makeBold(editVoiceAction->font()));
@@ -255,21 +282,22 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 		const auto removeVoiceAction = menu.addAction(tr("Remove voice"));
 		if (const auto action = menu.exec(pos); action == editVoiceAction)
 		{
-			if (!editVoiceName(voiceId, (*part)->_voiceName))
+			if (!editVoiceName(voiceId, part->_voiceName))
 				return;
 		}
 		else if (action == addTrackAction)
 		{
-			auto& track = (*part)->_tracks.emplace_back(std::make_shared<seir::synth::TrackData>(std::make_shared<seir::synth::TrackProperties>()));
-			_scene->addTrack(voiceId, track.get());
+			const auto track = std::make_shared<seir::synth::TrackData>(std::make_shared<seir::synth::TrackProperties>());
+			_model.addTrack(voiceId, track);
+			_scene->addTrack(voiceId, track);
 		}
 		else if (action == removeVoiceAction)
 		{
-			if (const auto message = tr("Remove %1 voice?").arg("<b>" + QString::fromStdString((*part)->_voiceName) + "</b>");
+			if (const auto message = tr("Remove %1 voice?").arg("<b>" + QString::fromStdString(part->_voiceName) + "</b>");
 				QMessageBox::question(this, {}, message, QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
 				return;
 			_scene->removeVoice(voiceId);
-			_composition->_parts.erase(part);
+			_model.removePart(voiceId);
 		}
 		else
 			return;
@@ -277,16 +305,172 @@ CompositionWidget::CompositionWidget(QWidget* parent)
 	});
 }
 
+void CompositionWidget::reloadComposition(const std::shared_ptr<seir::synth::CompositionData>& loaded)
+{
+	// The current composition is updated to match the loaded one in place, with parts, tracks and sequences matched by index.
+	// The matched objects keep their identity, so only the changed scene items are updated, and the view state is preserved.
+	// The loaded composition is consumed, its unmatched objects are moved into the current one.
+	// The data is changed directly, and the model is reindexed afterwards.
+	const auto composition = _model.composition();
+	assert(composition);
+	composition->_title = loaded->_title;
+	composition->_author = loaded->_author;
+	composition->_gainDivisor = loaded->_gainDivisor;
+	if (composition->_speed != loaded->_speed)
+	{
+		composition->_speed = loaded->_speed;
+		_scene->setSpeed(composition->_speed);
+	}
+	// All structural changes are laid out at once in the end.
+	_scene->beginTransaction();
+	const auto commonParts = std::min(composition->_parts.size(), loaded->_parts.size());
+	for (size_t i = 0; i < commonParts; ++i)
+		reloadPart(*composition->_parts[i], *loaded->_parts[i]);
+	while (composition->_parts.size() > commonParts)
+	{
+		_scene->removeVoice(composition->_parts.back()->_voice.get());
+		composition->_parts.pop_back();
+	}
+	for (size_t i = commonParts; i < loaded->_parts.size(); ++i)
+	{
+		// A part is appended to the scene with a single empty track, and the rest is added afterwards.
+		const auto& part = composition->_parts.emplace_back(loaded->_parts[i]);
+		assert(!part->_tracks.empty());
+		auto tracks = std::exchange(part->_tracks, {});
+		auto fragments = std::exchange(tracks.front()->_fragments, {});
+		part->_tracks.emplace_back(tracks.front());
+		_scene->appendPart(part);
+		part->_tracks.front()->_fragments = std::move(fragments);
+		insertFragments(*part->_tracks.front());
+		for (auto j = std::next(tracks.begin()); j != tracks.end(); ++j)
+		{
+			const auto& track = part->_tracks.emplace_back(*j);
+			_scene->addTrack(part->_voice.get(), track);
+			insertFragments(*track);
+		}
+	}
+	if (composition->_loopOffset != loaded->_loopOffset || composition->_loopLength != loaded->_loopLength)
+	{
+		composition->_loopOffset = loaded->_loopOffset;
+		composition->_loopLength = loaded->_loopLength;
+		_scene->updateLoop();
+	}
+	_scene->commitTransaction();
+	_model.reset(composition);
+	_scene->extendCompositionLength();
+	_scene->refreshSelection();
+	_scene->updateWaveforms(); // Voices, track properties and gain are updated without notifying the scene.
+}
+
 float CompositionWidget::selectedTrackWeight() const
 {
 	return _scene->selectedTrackWeight();
 }
 
+bool CompositionWidget::confirmTrackRemoval(const seir::synth::PartData& part, const void* trackId)
+{
+	const auto trackIt = std::find_if(part._tracks.cbegin(), part._tracks.cend(), [trackId](const auto& trackData) { return trackData.get() == trackId; });
+	assert(trackIt != part._tracks.cend());
+	const auto message = tr("Remove %1 track %2?").arg("<b>" + QString::fromStdString(part._voiceName) + "</b>").arg(trackIt - part._tracks.cbegin() + 1);
+	return QMessageBox::question(this, {}, message, QMessageBox::Yes | QMessageBox::No, QMessageBox::No) == QMessageBox::Yes;
+}
+
+void CompositionWidget::insertFragments(const seir::synth::TrackData& track)
+{
+	for (const auto& fragment : track._fragments)
+		_scene->insertFragment(&track, fragment.first, fragment.second);
+}
+
+void CompositionWidget::reloadPart(seir::synth::PartData& part, const seir::synth::PartData& loaded)
+{
+	const auto voiceId = part._voice.get();
+	*part._voice = *loaded._voice;
+	if (part._voiceName != loaded._voiceName)
+	{
+		part._voiceName = loaded._voiceName;
+		_scene->updateVoice(voiceId, part._voiceName);
+	}
+	const auto commonTracks = std::min(part._tracks.size(), loaded._tracks.size());
+	for (size_t i = 0; i < commonTracks; ++i)
+		reloadTrack(*part._tracks[i], *loaded._tracks[i]);
+	while (part._tracks.size() > commonTracks)
+	{
+		_scene->removeTrack(voiceId, part._tracks.back().get());
+		part._tracks.pop_back();
+	}
+	for (size_t i = commonTracks; i < loaded._tracks.size(); ++i)
+	{
+		const auto& track = part._tracks.emplace_back(loaded._tracks[i]);
+		_scene->addTrack(voiceId, track);
+		insertFragments(*track);
+	}
+}
+
+void CompositionWidget::reloadTrack(seir::synth::TrackData& track, const seir::synth::TrackData& loaded)
+{
+	*track._properties = *loaded._properties;
+
+	// Loaded sequences are mapped to the current ones, which are updated in place if their sounds have changed.
+	std::unordered_map<const seir::synth::SequenceData*, std::shared_ptr<seir::synth::SequenceData>> sequences;
+	const auto commonSequences = std::min(track._sequences.size(), loaded._sequences.size());
+	for (size_t i = 0; i < commonSequences; ++i)
+	{
+		const auto& sequence = track._sequences[i];
+		if (!::haveSameSounds(*sequence, *loaded._sequences[i]))
+		{
+			sequence->_sounds = loaded._sequences[i]->_sounds;
+			_scene->updateSequence(&track, sequence);
+		}
+		sequences.emplace(loaded._sequences[i].get(), sequence);
+	}
+	track._sequences.resize(commonSequences);
+	for (size_t i = commonSequences; i < loaded._sequences.size(); ++i)
+		sequences.emplace(loaded._sequences[i].get(), track._sequences.emplace_back(loaded._sequences[i]));
+
+	// Both fragment maps are ordered by offset, so the changes are found in a single pass.
+	std::map<size_t, std::shared_ptr<seir::synth::SequenceData>> fragments;
+	for (const auto& fragment : loaded._fragments)
+	{
+		const auto sequenceIt = sequences.find(fragment.second.get());
+		fragments.emplace_hint(fragments.end(), fragment.first, sequenceIt != sequences.end() ? sequenceIt->second : fragment.second);
+	}
+	for (auto i = track._fragments.cbegin(), j = fragments.cbegin(); i != track._fragments.cend() || j != fragments.cend();)
+	{
+		if (j == fragments.cend() || (i != track._fragments.cend() && i->first < j->first))
+		{
+			_scene->removeFragment(&track, i->first);
+			++i;
+		}
+		else if (i == track._fragments.cend() || j->first < i->first)
+		{
+			_scene->insertFragment(&track, j->first, j->second);
+			++j;
+		}
+		else
+		{
+			if (i->second != j->second)
+			{
+				_scene->removeFragment(&track, i->first);
+				_scene->insertFragment(&track, j->first, j->second);
+			}
+			++i;
+			++j;
+		}
+	}
+	track._fragments = std::move(fragments);
+}
+
 void CompositionWidget::setComposition(const std::shared_ptr<seir::synth::CompositionData>& composition)
 {
-	_scene->reset(composition, _view->width());
+	_model.reset(composition);
+	_scene->reset();
 	_view->horizontalScrollBar()->setValue(_view->horizontalScrollBar()->minimum());
-	_composition = composition;
+	updateVisibleRect();
+}
+
+void CompositionWidget::resetZoom()
+{
+	setZoomLevel(0, _view->viewport()->rect().center().x());
 }
 
 void CompositionWidget::setInteractive(bool interactive)
@@ -294,6 +478,11 @@ void CompositionWidget::setInteractive(bool interactive)
 	_view->setInteractive(interactive);
 }
 
+void CompositionWidget::setMinimapVisible(bool visible)
+{
+	_minimap->setVisible(visible);
+}
+
 void CompositionWidget::setPlaybackOffset(double step)
 {
 	const auto sceneCursorRect = _scene->setCurrentStep(step);
@@ -313,6 +502,11 @@ void CompositionWidget::setSpeed(unsigned speed)
 	_scene->setSpeed(speed);
 }
 
+void CompositionWidget::setWaveformsVisible(bool visible)
+{
+	_scene->setWaveformsVisible(visible);
+}
+
 void CompositionWidget::showCursor(bool visible)
 {
 	_scene->showCursor(visible);
@@ -328,6 +522,22 @@ void CompositionWidget::updateSelectedSequence(const std::shared_ptr<seir::synth
 	_scene->updateSelectedSequence(sequence);
 }
 
+void CompositionWidget::updateWaveforms()
+{
+	_model.updateTotalTrackWeight(); // Track weights may have been changed.
+	_scene->updateWaveforms();
+}
+
+void CompositionWidget::zoomIn()
+{
+	setZoomLevel(_zoomLevel + 1, _view->viewport()->rect().center().x());
+}
+
+void CompositionWidget::zoomOut()
+{
+	setZoomLevel(_zoomLevel - 1, _view->viewport()->rect().center().x());
+}
+
 bool CompositionWidget::editVoiceName(const void* id, std::string& voiceName)
 {
 	_voiceEditor->setVoiceName(voiceName);
@@ -338,3 +548,52 @@ bool CompositionWidget::editVoiceName(const void* id, std::string& voiceName)
 	_view->horizontalScrollBar()->setValue(_view->horizontalScrollBar()->minimum());
 	return true;
 }
+
+bool CompositionWidget::eventFilter(QObject* object, QEvent* e)
+{
+	if (object == _view->viewport() && e->type() == QEvent::Wheel)
+	{
+		if (const auto wheelEvent = static_cast<QWheelEvent*>(e); wheelEvent->modifiers() & Qt::ControlModifier)
+		{
+			if (const auto delta = wheelEvent->angleDelta().y(); delta != 0)
+				setZoomLevel(_zoomLevel + (delta > 0 ? 1 : -1), wheelEvent->position().toPoint().x());
+			return true;
+		}
+	}
+	return QWidget::eventFilter(object, e);
+}
+
+void CompositionWidget::resizeEvent(QResizeEvent* e)
+{
+	QWidget::resizeEvent(e);
+	updateVisibleRect(); // The scroll bars don't change if the scene fits into the view.
+}
+
+void CompositionWidget::setZoomLevel(int level, int anchorX)
+{
+	level = std::clamp(level, kMinZoomLevel, kMaxZoomLevel);
+	if (level == _zoomLevel)
+		return;
+	const auto voiceColumnWidth = _scene->voiceColumnWidth();
+	const auto oldStepWidth = _scene->stepWidth();
+	const auto anchorSceneX = _view->mapToScene(anchorX, 0).x();
+	_zoomLevel = level;
+	_scene->setStepWidth(kStepWidth * std::ldexp(1.0, level));
+	// The composition position under the anchor stays where it was.
+	if (anchorSceneX > voiceColumnWidth)
+	{
+		const auto scrollBar = _view->horizontalScrollBar();
+		scrollBar->setValue(scrollBar->value() + static_cast<int>(std::lround((anchorSceneX - voiceColumnWidth) * (_scene->stepWidth() / oldStepWidth - 1))));
+	}
+	updateVisibleRect();
+}
+
+void CompositionWidget::updateVisibleRect()
+{
+	const auto visibleRect = _view->mapToScene(_view->viewport()->rect()).boundingRect();
+	_scene->setVisibleRect(visibleRect);
+	const auto stepWidth = _scene->stepWidth();
+	const auto left = std::max(visibleRect.left() - _scene->voiceColumnWidth(), qreal{ 0 }) / stepWidth;
+	const auto top = std::max(visibleRect.top() - kCompositionHeaderHeight, qreal{ 0 }) / kTrackHeight;
+	_minimap->setVisibleArea({ QPointF{ left, top }, QPointF{ (visibleRect.right() - _scene->voiceColumnWidth()) / stepWidth, (visibleRect.bottom() - kCompositionHeaderHeight) / kTrackHeight } });
+}
@@ -4,22 +4,25 @@
 
 #pragma once
 
+#include "composition_model.hpp"
+
 #include <memory>
 #include <string>
 
 #include <QWidget>
 
-class QGraphicsView;
-
 namespace seir::synth
 {
 	struct CompositionData;
+	struct PartData;
 	struct SequenceData;
 	struct TrackData;
 	struct VoiceData;
 }
 
+class CompositionMinimap;
 class CompositionScene;
+class CompositionView;
 class VoiceEditor;
 
 class CompositionWidget final : public QWidget
@@ -29,25 +32,42 @@ class CompositionWidget final : public QWidget
 public:
 	explicit CompositionWidget(QWidget* parent);
 
+	void reloadComposition(const std::shared_ptr<seir::synth::CompositionData>&);
 	float selectedTrackWeight() const;
 	void setComposition(const std::shared_ptr<seir::synth::CompositionData>&);
 	void setInteractive(bool);
+	void setMinimapVisible(bool);
 	void setPlaybackOffset(double);
 	void setSpeed(unsigned speed);
+	void setWaveformsVisible(bool);
 	void showCursor(bool);
 	size_t startOffset() const;
+	void resetZoom();
 	void updateSelectedSequence(const std::shared_ptr<seir::synth::SequenceData>&);
+	void updateWaveforms();
+	void zoomIn();
+	void zoomOut();
 
 signals:
 	void compositionChanged();
 	void selectionChanged(const std::shared_ptr<seir::synth::VoiceData>&, const std::shared_ptr<seir::synth::TrackData>&, const std::shared_ptr<seir::synth::SequenceData>&);
 
 private:
+	bool confirmTrackRemoval(const seir::synth::PartData&, const void* trackId);
 	bool editVoiceName(const void* id, std::string&);
+	bool eventFilter(QObject*, QEvent*) override;
+	void insertFragments(const seir::synth::TrackData&);
+	void reloadPart(seir::synth::PartData&, const seir::synth::PartData& loaded);
+	void reloadTrack(seir::synth::TrackData&, const seir::synth::TrackData& loaded);
+	void resizeEvent(QResizeEvent*) override;
+	void setZoomLevel(int level, int anchorX);
+	void updateVisibleRect();
 
 private:
 	std::unique_ptr<VoiceEditor> _voiceEditor;
+	CompositionModel _model;
 	CompositionScene* const _scene;
-	QGraphicsView* _view = nullptr;
-	std::shared_ptr<seir::synth::CompositionData> _composition;
+	CompositionView* _view = nullptr;
+	CompositionMinimap* _minimap = nullptr;
+	int _zoomLevel = 0;
 };
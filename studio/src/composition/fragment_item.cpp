@@ -8,56 +8,140 @@
 
 #include <seir_synth/data.hpp>
 
+#include <algorithm>
 #include <numeric>
 
 #include <QGraphicsSceneEvent>
 #include <QMenu>
 #include <QPainter>
+#include <QStaticText>
 #include <QTextOption>
 
-FragmentItem::FragmentItem(size_t trackIndex, size_t offset, const void* sequenceId, QGraphicsItem* parent)
-	: QGraphicsObject{ parent }
-	, _trackIndex{ trackIndex }
-	, _offset{ offset }
-	, _sequenceId{ sequenceId }
+namespace
+{
+	// Bigger fragments are painted directly, their pixmaps would take too much memory.
+	constexpr qreal kMaxPixmapWidth = 4096;
+}
+
+FragmentLayout::FragmentLayout(std::vector<FragmentSound>&& sounds, qreal stepWidth)
+	: _sounds{ std::move(sounds) }
+	, _stepWidth{ stepWidth }
+	, _arrowWidth{ kFragmentArrowWidth * stepWidth / kStepWidth }
 {
+	if (!_sounds.empty())
+	{
+		_length = std::accumulate(_sounds.begin(), _sounds.end(), size_t{ 1 }, [](size_t length, const FragmentSound& sound) { return length + sound._delay; });
+		auto end = std::find_if(_sounds.rbegin(), _sounds.rend(), [](const FragmentSound& sound) { return sound._delay != 0; });
+		if (end != _sounds.rend())
+			++end;
+		_length += std::max_element(_sounds.rbegin(), end, [](const FragmentSound& a, const FragmentSound& b) { return a._sustain < b._sustain; })->_sustain;
+	}
+	_width = _length * _stepWidth;
 	_polygon.reserve(5);
+	_polygon << QPointF{ 0, 0 } << QPointF{ _width, 0 } << QPointF{ _width + _arrowWidth, kTrackHeight / 2 } << QPointF{ _width, kTrackHeight } << QPointF{ 0, kTrackHeight };
+	if (_stepWidth < kMinFragmentTextStepWidth && _stepWidth >= kMinFragmentNoteStepWidth)
+	{
+		size_t position = 0;
+		for (const auto& sound : _sounds)
+		{
+			if (sound._delay || _onsetLines.empty())
+			{
+				position += sound._delay;
+				const auto x = (position + 0.5) * _stepWidth;
+				_onsetLines.emplace_back(x, kTrackHeight / 4, x, kTrackHeight * 3 / 4);
+			}
+		}
+	}
 }
 
-QRectF FragmentItem::boundingRect() const
+QRectF FragmentLayout::boundingRect() const noexcept
 {
-	return { 0, 0, _width + kFragmentArrowWidth, kTrackHeight };
+	return { 0, 0, _width + _arrowWidth, kTrackHeight };
 }
 
-void FragmentItem::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
+void FragmentLayout::paint(QPainter* painter, const QColor& brush, const QColor& pen, int penWidth) const
 {
-	const auto& colors = _highlighted ? kFragmentHighlightColors[_trackIndex % kFragmentHighlightColors.size()] : kFragmentColors[_trackIndex % kFragmentColors.size()];
-	QPen pen{ colors._pen };
-	pen.setWidth(_selected ? 3 : 0);
-	painter->setPen(pen);
-	painter->setBrush(colors._brush);
+	QPen polygonPen{ pen };
+	polygonPen.setWidth(penWidth);
+	painter->setPen(polygonPen);
+	painter->setBrush(brush);
 	painter->drawConvexPolygon(_polygon);
-	if (!_sounds.empty())
+	if (!_onsetLines.empty())
+	{
+		painter->setPen(pen);
+		painter->drawLines(_onsetLines.data(), static_cast<int>(_onsetLines.size()));
+	}
+	else if (!_sounds.empty() && _stepWidth >= kMinFragmentTextStepWidth)
 	{
 		constexpr auto xScale = 7.0 / 16.0;
+		static const QStaticText sustain{ "-" };
 		painter->save();
 		auto font = painter->font();
 		font.setPixelSize(kFragmentFontSize);
 		painter->setFont(font);
 		painter->setTransform(QTransform::fromScale(xScale, 1.0), true);
 		QPointF topLeft{ 1 / xScale, (kTrackHeight - QFontMetricsF{ font }.height()) / 2 };
-		QStaticText sustain{ "-" };
 		for (const auto& sound : _sounds)
 		{
-			topLeft.rx() += sound._delay * kStepWidth / xScale;
+			topLeft.rx() += sound._delay * _stepWidth / xScale;
 			painter->drawStaticText(topLeft, *sound._text);
 			for (size_t i = 0; i < sound._sustain; ++i)
-				painter->drawStaticText(QPointF(topLeft.x() + (i + 1) * kStepWidth / xScale, topLeft.y()), sustain);
+				painter->drawStaticText(QPointF(topLeft.x() + (i + 1) * _stepWidth / xScale, topLeft.y()), sustain);
 		}
 		painter->restore();
 	}
 }
 
+const QPixmap& FragmentLayout::pixmap(const QColor& brush, const QColor& pen, qreal devicePixelRatio) const
+{
+	auto& pixmap = _pixmaps[{ brush.rgba(), pen.rgba(), devicePixelRatio }];
+	if (pixmap.isNull() && (_width + _arrowWidth) * devicePixelRatio <= kMaxPixmapWidth)
+	{
+		pixmap = QPixmap{ QSizeF{ (_width + _arrowWidth + 1) * devicePixelRatio, (kTrackHeight + 1) * devicePixelRatio }.toSize() };
+		pixmap.setDevicePixelRatio(devicePixelRatio);
+		pixmap.fill(Qt::transparent);
+		QPainter painter{ &pixmap };
+		paint(&painter, brush, pen, 0);
+	}
+	return pixmap;
+}
+
+FragmentItem::FragmentItem(QGraphicsItem* parent)
+	: QGraphicsObject{ parent }
+{
+}
+
+QRectF FragmentItem::boundingRect() const
+{
+	return _layout ? _layout->boundingRect() : QRectF{};
+}
+
+void FragmentItem::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
+{
+	if (!_layout)
+		return;
+	const auto& colors = _highlighted ? kFragmentHighlightColors[_trackIndex % kFragmentHighlightColors.size()] : kFragmentColors[_trackIndex % kFragmentColors.size()];
+	if (!_selected)
+	{
+		// The pixmap is shared by all fragments of the sequence which are painted with the same colors.
+		if (const auto& pixmap = _layout->pixmap(colors._brush, colors._pen, painter->device()->devicePixelRatioF()); !pixmap.isNull())
+		{
+			painter->drawPixmap(QPointF{}, pixmap);
+			return;
+		}
+	}
+	_layout->paint(painter, colors._brush, colors._pen, _selected ? 3 : 0);
+}
+
+void FragmentItem::setFragment(const void* trackId, size_t trackIndex, size_t offset, const void* sequenceId)
+{
+	_trackId = trackId;
+	_trackIndex = trackIndex;
+	_offset = offset;
+	_sequenceId = sequenceId;
+	update();
+}
+
 void FragmentItem::setHighlighted(bool highlighted, bool selected)
 {
 	if (!highlighted)
@@ -69,23 +153,12 @@ void FragmentItem::setHighlighted(bool highlighted, bool selected)
 	update();
 }
 
-void FragmentItem::setSequence(const std::vector<FragmentSound>& sounds)
+void FragmentItem::setLayout(const std::shared_ptr<const FragmentLayout>& layout)
 {
+	if (_layout == layout)
+		return;
 	prepareGeometryChange();
-	_sounds = sounds;
-	if (!sounds.empty())
-	{
-		_length = std::accumulate(sounds.begin(), sounds.end(), size_t{ 1 }, [](size_t length, const FragmentSound& sound) { return length + sound._delay; });
-		auto end = std::find_if(sounds.rbegin(), sounds.rend(), [](const FragmentSound& sound) { return sound._delay != 0; });
-		if (end != sounds.rend())
-			++end;
-		_length += std::max_element(sounds.rbegin(), end, [](const FragmentSound& a, const FragmentSound& b) { return a._sustain < b._sustain; })->_sustain;
-	}
-	else
-		_length = 0;
-	_width = _length * kStepWidth;
-	_polygon.clear();
-	_polygon << QPointF{ 0, 0 } << QPointF{ _width, 0 } << QPointF{ _width + kFragmentArrowWidth, kTrackHeight / 2 } << QPointF{ _width, kTrackHeight } << QPointF{ 0, kTrackHeight };
+	_layout = layout;
 }
 
 void FragmentItem::setTrackIndex(size_t index)
@@ -96,14 +169,14 @@ void FragmentItem::setTrackIndex(size_t index)
 
 void FragmentItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
 {
-	e->setAccepted(_polygon.containsPoint(e->pos(), Qt::OddEvenFill));
+	e->setAccepted(_layout && _layout->polygon().containsPoint(e->pos(), Qt::OddEvenFill));
 	if (e->isAccepted())
-		emit fragmentMenuRequested(_offset, e->screenPos());
+		emit fragmentMenuRequested(_trackId, _offset, e->screenPos());
 }
 
 void FragmentItem::mousePressEvent(QGraphicsSceneMouseEvent* e)
 {
 	if (e->button() == Qt::LeftButton)
-		emit fragmentSelected(_sequenceId, _offset);
+		emit fragmentSelected(_trackId, _sequenceId, _offset);
 	QGraphicsObject::mousePressEvent(e);
 }
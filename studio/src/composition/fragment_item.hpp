@@ -4,10 +4,14 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #include <QGraphicsObject>
+#include <QPixmap>
+#include <QPolygonF>
 
 class QStaticText;
 
@@ -21,38 +25,62 @@ struct FragmentSound
 		: _delay{ delay }, _text{ text }, _sustain{ sustain } {}
 };
 
+// Immutable layout shared by all fragments of a sequence.
+class FragmentLayout
+{
+public:
+	FragmentLayout(std::vector<FragmentSound>&&, qreal stepWidth);
+
+	QRectF boundingRect() const noexcept;
+	size_t length() const noexcept { return _length; }
+	void paint(QPainter*, const QColor& brush, const QColor& pen, int penWidth) const;
+	// Returns the fragment painted into a pixmap, or a null pixmap if it's too big to be cached.
+	const QPixmap& pixmap(const QColor& brush, const QColor& pen, qreal devicePixelRatio) const;
+	const QPolygonF& polygon() const noexcept { return _polygon; }
+
+private:
+	const std::vector<FragmentSound> _sounds;
+	const qreal _stepWidth;
+	const qreal _arrowWidth;
+	size_t _length = 0;
+	qreal _width = 0;
+	QPolygonF _polygon;
+	std::vector<QLineF> _onsetLines; // Shown instead of the notes if the steps are too narrow for them.
+	mutable std::map<std::tuple<QRgb, QRgb, qreal>, QPixmap> _pixmaps;
+};
+
 class FragmentItem final : public QGraphicsObject
 {
 	Q_OBJECT
 
 public:
-	FragmentItem(size_t trackIndex, size_t offset, const void* sequenceId, QGraphicsItem* parent);
+	explicit FragmentItem(QGraphicsItem* parent);
 
 	QRectF boundingRect() const override;
-	size_t fragmentLength() const noexcept { return _length; }
+	size_t fragmentLength() const noexcept { return _layout ? _layout->length() : 0; }
 	size_t fragmentOffset() const noexcept { return _offset; }
 	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
 	const void* sequenceId() const noexcept { return _sequenceId; }
+	void setFragment(const void* trackId, size_t trackIndex, size_t offset, const void* sequenceId);
 	void setHighlighted(bool highlighted, bool selected);
-	void setSequence(const std::vector<FragmentSound>&);
+	void setLayout(const std::shared_ptr<const FragmentLayout>&);
 	void setTrackIndex(size_t index);
+	const void* trackId() const noexcept { return _trackId; }
 
 signals:
-	void fragmentMenuRequested(size_t offset, const QPoint& pos);
-	void fragmentSelected(const void* sequenceId, size_t offset);
+	void fragmentMenuRequested(const void* trackId, size_t offset, const QPoint& pos);
+	void fragmentSelected(const void* trackId, const void* sequenceId, size_t offset);
 
 private:
 	void contextMenuEvent(QGraphicsSceneContextMenuEvent*) override;
 	void mousePressEvent(QGraphicsSceneMouseEvent*) override;
 
 private:
-	size_t _trackIndex;
-	const size_t _offset;
-	const void* const _sequenceId;
-	std::vector<FragmentSound> _sounds;
-	size_t _length = 0;
-	qreal _width = 0;
-	QPolygonF _polygon;
+	const void* _trackId = nullptr;
+	size_t _trackIndex = 0;
+	size_t _offset = 0;
+	const void* _sequenceId = nullptr;
+	std::shared_ptr<const FragmentLayout> _layout;
 	bool _highlighted = false;
 	bool _selected = false;
 };
@@ -11,12 +11,13 @@
 
 LoopItem::LoopItem(QGraphicsItem* parent)
 	: QGraphicsObject{ parent }
+	, _stepWidth{ kStepWidth }
 {
 }
 
 QRectF LoopItem::boundingRect() const
 {
-	return { 0, 0, kStepWidth * _loopLength, kLoopItemHeight };
+	return { 0, 0, _stepWidth * _loopLength, kLoopItemHeight };
 }
 
 void LoopItem::paint(QPainter* painter, const QStyleOptionGraphicsItem*, QWidget*)
@@ -32,6 +33,12 @@ void LoopItem::setLoopLength(size_t length)
 	_loopLength = length;
 }
 
+void LoopItem::setStepWidth(qreal width)
+{
+	prepareGeometryChange();
+	_stepWidth = width;
+}
+
 void LoopItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
 {
 	e->accept();
@@ -16,6 +16,7 @@ public:
 	QRectF boundingRect() const override;
 	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
 	void setLoopLength(size_t);
+	void setStepWidth(qreal);
 
 signals:
 	void menuRequested(const QPoint& pos);
@@ -25,4 +26,5 @@ private:
 
 private:
 	size_t _loopLength = 0;
+	qreal _stepWidth;
 };
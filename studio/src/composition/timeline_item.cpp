@@ -6,14 +6,23 @@
 
 #include "../theme.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 
 #include <QGraphicsSceneEvent>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 
+namespace
+{
+	// Possible timeline intervals in seconds.
+	constexpr std::array<size_t, 12> kTimelineIntervals{ 1, 2, 5, 10, 15, 30, 60, 120, 300, 600, 1800, 3600 };
+}
+
 TimelineItem::TimelineItem(QGraphicsItem* parent)
 	: QGraphicsObject{ parent }
+	, _stepWidth{ kStepWidth }
 {
 	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
@@ -24,48 +33,54 @@ TimelineItem::TimelineItem(QGraphicsItem* parent)
 
 QRectF TimelineItem::boundingRect() const
 {
-	return { 0, 0, _length * kStepWidth, kCompositionHeaderHeight };
+	return { 0, 0, _length * _stepWidth, kCompositionHeaderHeight };
 }
 
 void TimelineItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
 {
 	painter->save();
-	painter->translate(QPointF{ _offset * kStepWidth, 0 });
+	painter->translate(QPointF{ _offset * _stepWidth, 0 });
 	painter->setPen(kTimelineOffsetMarkColors._pen);
 	painter->setBrush(kTimelineOffsetMarkColors._brush);
 	painter->drawConvexPolygon(_offsetMark);
 	painter->restore();
 
-	size_t index = 0;
-	QRectF rect{ 0, kCompositionHeaderHeight - kTimelineHeight, _speed * kStepWidth, kTimelineHeight };
+	if (!_length)
+		return;
+
+	// Seconds are grouped into intervals wide enough to be labeled.
+	const auto secondWidth = _speed * _stepWidth;
+	const auto intervalSeconds = *std::find_if(kTimelineIntervals.begin(), std::prev(kTimelineIntervals.end()), [secondWidth](size_t seconds) { return seconds * secondWidth >= kMinTimelineLabelWidth; });
+	const auto intervalSteps = intervalSeconds * _speed;
+	const auto intervalWidth = intervalSteps * _stepWidth;
+
+	// The exposed intervals are found directly, so repainting doesn't depend on the composition length.
+	const auto intervalCount = (_length + intervalSteps - 1) / intervalSteps;
+	const auto firstIndex = static_cast<size_t>(std::floor(std::max(option->exposedRect.left(), qreal{ 0 }) / intervalWidth));
+	const auto lastIndex = std::min(static_cast<size_t>(std::floor(std::max(option->exposedRect.right(), qreal{ 0 }) / intervalWidth)) + 1, intervalCount);
+
 	constexpr auto textOffset = (kTimelineHeight - kTimelineFontSize) / 2.0;
 	auto font = painter->font();
 	font.setPixelSize(kTimelineFontSize);
 	painter->setFont(font);
-	while (index < _length / _speed)
+	for (auto index = firstIndex; index < lastIndex; ++index)
 	{
-		if (rect.left() > option->exposedRect.right())
-			return;
-		if (rect.right() >= option->exposedRect.left())
+		const auto& colors = kTimelineColors[index % kTimelineColors.size()];
+		QRectF rect{ index * intervalWidth, kCompositionHeaderHeight - kTimelineHeight, intervalWidth, kTimelineHeight };
+		painter->setPen(Qt::transparent);
+		painter->setBrush(colors._brush);
+		if ((index + 1) * intervalSteps > _length)
 		{
-			const auto& colors = kTimelineColors[index % kTimelineColors.size()];
-			painter->setPen(Qt::transparent);
-			painter->setBrush(colors._brush);
+			// The last incomplete interval isn't labeled.
+			rect.setRight(_length * _stepWidth);
 			painter->drawRect(rect);
-			painter->setPen(colors._pen);
-			const auto seconds = index + 1;
-			painter->drawText(rect.adjusted(-textOffset, 0.0, -textOffset, 0.0), Qt::AlignRight | Qt::AlignVCenter,
-				seconds < 60 ? QString::number(seconds) : QStringLiteral("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QLatin1Char{ '0' }));
+			break;
 		}
-		rect.moveLeft(rect.right());
-		++index;
-	}
-	if (_length % _speed && rect.left() <= option->exposedRect.right() && rect.right() >= option->exposedRect.left())
-	{
-		rect.setRight(_length * kStepWidth);
-		painter->setPen(Qt::transparent);
-		painter->setBrush(kTimelineColors[index % kTimelineColors.size()]._brush);
 		painter->drawRect(rect);
+		painter->setPen(colors._pen);
+		const auto& text = label((index + 1) * intervalSeconds, font);
+		const auto textSize = text.size();
+		painter->drawStaticText(QPointF{ rect.right() - textOffset - textSize.width(), rect.top() + (kTimelineHeight - textSize.height()) / 2 }, text);
 	}
 }
 
@@ -87,15 +102,33 @@ void TimelineItem::setCompositionSpeed(unsigned speed)
 	update();
 }
 
+void TimelineItem::setStepWidth(qreal width)
+{
+	prepareGeometryChange();
+	_stepWidth = width;
+}
+
+const QStaticText& TimelineItem::label(size_t seconds, const QFont& font)
+{
+	auto i = _labels.find(seconds);
+	if (i == _labels.end())
+	{
+		i = _labels.emplace(seconds, seconds < 60 ? QString::number(seconds) : QStringLiteral("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QLatin1Char{ '0' })).first;
+		i->second.setTextFormat(Qt::PlainText);
+		i->second.prepare({}, font);
+	}
+	return i->second;
+}
+
 void TimelineItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
 {
 	e->accept();
-	emit menuRequested(static_cast<size_t>(std::ceil(e->pos().x()) / kStepWidth), e->screenPos());
+	emit menuRequested(static_cast<size_t>(std::ceil(e->pos().x()) / _stepWidth), e->screenPos());
 }
 
 void TimelineItem::mousePressEvent(QGraphicsSceneMouseEvent* e)
 {
 	if (e->button() == Qt::LeftButton)
-		setCompositionOffset(static_cast<size_t>(std::ceil(e->pos().x()) / kStepWidth));
+		setCompositionOffset(static_cast<size_t>(std::ceil(e->pos().x()) / _stepWidth));
 	QGraphicsItem::mousePressEvent(e);
 }
@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <unordered_map>
+
 #include <QGraphicsObject>
+#include <QStaticText>
 
 class TimelineItem final : public QGraphicsObject
 {
@@ -18,6 +21,7 @@ public:
 	void setCompositionLength(size_t length);
 	void setCompositionOffset(size_t offset);
 	void setCompositionSpeed(unsigned speed);
+	void setStepWidth(qreal);
 	size_t compositionLength() const noexcept { return _length; }
 	size_t compositionOffset() const noexcept { return _offset; }
 	unsigned compositionSpeed() const noexcept { return _speed; }
@@ -27,11 +31,14 @@ signals:
 
 private:
 	void contextMenuEvent(QGraphicsSceneContextMenuEvent*) override;
+	const QStaticText& label(size_t seconds, const QFont&);
 	void mousePressEvent(QGraphicsSceneMouseEvent*) override;
 
 private:
+	qreal _stepWidth;
 	unsigned _speed = 1;
 	size_t _length = 0;
 	size_t _offset = 0;
 	QPolygonF _offsetMark;
+	std::unordered_map<size_t, QStaticText> _labels; // Keyed by seconds, which don't depend on the zoom level.
 };
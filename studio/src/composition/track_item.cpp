@@ -16,13 +16,14 @@
 TrackItem::TrackItem(const void* id, QGraphicsItem* parent)
 	: QGraphicsObject{ parent }
 	, _trackId{ id }
+	, _stepWidth{ kStepWidth }
 {
 	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 }
 
 QRectF TrackItem::boundingRect() const
 {
-	return { 0, 0, _length * kStepWidth, kTrackHeight };
+	return { 0, 0, _length * _stepWidth, kTrackHeight };
 }
 
 void TrackItem::setFirstTrack(bool first)
@@ -31,6 +32,12 @@ void TrackItem::setFirstTrack(bool first)
 	update();
 }
 
+void TrackItem::setStepWidth(qreal width)
+{
+	prepareGeometryChange();
+	_stepWidth = width;
+}
+
 void TrackItem::setTrackIndex(size_t index)
 {
 	_index = index;
@@ -45,7 +52,7 @@ void TrackItem::setTrackLength(size_t length)
 
 void TrackItem::contextMenuEvent(QGraphicsSceneContextMenuEvent* e)
 {
-	emit trackMenuRequested(_trackId, static_cast<size_t>(std::ceil(e->pos().x()) / kStepWidth), e->screenPos());
+	emit trackMenuRequested(_trackId, static_cast<size_t>(std::ceil(e->pos().x()) / _stepWidth), e->screenPos());
 }
 
 void TrackItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
@@ -53,17 +60,24 @@ void TrackItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option,
 	if (!_length)
 		return;
 	const auto& colors = kTrackColors[_index % kTrackColors.size()]._colors;
-	auto step = static_cast<size_t>(std::floor(option->exposedRect.left() / kStepWidth));
-	QRectF rect{ { step * kStepWidth, 0 }, QSizeF{ kStepWidth, kTrackHeight } };
+	// Steps are grouped into cells of a power of two steps wide enough to be distinguishable.
+	size_t cellSteps = 1;
+	while (cellSteps * _stepWidth < kMinTrackGridCellWidth)
+		cellSteps *= 2;
+	const auto cellWidth = cellSteps * _stepWidth;
+	auto cell = static_cast<size_t>(std::floor(option->exposedRect.left() / cellWidth));
+	QRectF rect{ { cell * cellWidth, 0 }, QSizeF{ cellWidth, kTrackHeight } };
 	painter->setPen(Qt::transparent);
-	while (step < _length)
+	while (cell * cellSteps < _length)
 	{
-		painter->setBrush(colors[step % colors.size()]);
+		if ((cell + 1) * cellSteps > _length)
+			rect.setRight(_length * _stepWidth);
+		painter->setBrush(colors[cell % colors.size()]);
 		painter->drawRect(rect);
 		if (rect.right() > option->exposedRect.right())
 			break;
 		rect.moveLeft(rect.right());
-		++step;
+		++cell;
 	}
 	if (_first)
 	{
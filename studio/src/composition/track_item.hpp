@@ -16,10 +16,12 @@ public:
 	QRectF boundingRect() const override;
 	bool isFirstTrack() const noexcept { return _first; }
 	void setFirstTrack(bool);
+	void setStepWidth(qreal);
 	void setTrackIndex(size_t);
 	void setTrackLength(size_t);
 	const void* trackId() const noexcept { return _trackId; }
 	size_t trackIndex() const noexcept { return _index; }
+	size_t trackLength() const noexcept { return _length; }
 
 signals:
 	void trackMenuRequested(const void* trackId, size_t offset, const QPoint& pos);
@@ -30,6 +32,7 @@ private:
 
 private:
 	const void* const _trackId;
+	qreal _stepWidth;
 	size_t _length = 0;
 	size_t _index = 0;
 	bool _first = false;
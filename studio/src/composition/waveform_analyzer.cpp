@@ -0,0 +1,221 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "waveform_analyzer.hpp"
+
+#include <aulos_core/composition.hpp>
+
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+	// The envelope only has to show loudness and peaks, and the high frequencies barely change them.
+	constexpr seir::synth::AudioFormat kAnalysisFormat{ 24'000, seir::synth::ChannelLayout::Mono };
+	constexpr size_t kBlockFrames = 4096;
+
+	// The cache is dropped as a whole when it grows too big, which is simpler than tracking the usage
+	// and happens rarely since the entries are replaced only when the tracks are edited.
+	constexpr size_t kMaxCacheSize = 256;
+
+	// Reduces consecutive samples to the envelope bins.
+	// The samples are accumulated in independent lanes which compilers turn into vector operations.
+	class Decimator
+	{
+	public:
+		explicit Decimator(double framesPerBin) noexcept
+			: _framesPerBin{ framesPerBin }
+		{
+			assert(_framesPerBin >= 1);
+			startBin();
+		}
+
+		void add(const float* data, size_t frames)
+		{
+			while (frames > 0)
+			{
+				const auto count = std::min(frames, _binEnd - _frame);
+				accumulate(data, count);
+				data += count;
+				frames -= count;
+				_frame += count;
+				if (_frame == _binEnd)
+					finishBin();
+			}
+		}
+
+		std::vector<TrackEnvelope::Bin> finish()
+		{
+			if (_frame > _binBegin)
+				finishBin();
+			return std::move(_bins);
+		}
+
+	private:
+		static constexpr size_t kLanes = 8;
+
+		void accumulate(const float* data, size_t frames) noexcept
+		{
+			for (; frames >= kLanes; data += kLanes, frames -= kLanes)
+				for (size_t i = 0; i < kLanes; ++i)
+				{
+					_minimums[i] = std::min(_minimums[i], data[i]);
+					_maximums[i] = std::max(_maximums[i], data[i]);
+					_squares[i] += data[i] * data[i];
+				}
+			for (size_t i = 0; i < frames; ++i)
+			{
+				_minimums[i] = std::min(_minimums[i], data[i]);
+				_maximums[i] = std::max(_maximums[i], data[i]);
+				_squares[i] += data[i] * data[i];
+			}
+		}
+
+		void finishBin()
+		{
+			auto& bin = _bins.emplace_back();
+			bin._min = *std::min_element(_minimums.cbegin(), _minimums.cend());
+			bin._max = *std::max_element(_maximums.cbegin(), _maximums.cend());
+			float squares = 0;
+			for (const auto value : _squares)
+				squares += value;
+			bin._rms = std::sqrt(squares / static_cast<float>(_frame - _binBegin));
+			startBin();
+		}
+
+		void startBin() noexcept
+		{
+			_binBegin = _frame;
+			_binEnd = static_cast<size_t>(std::llround((_bins.size() + 1) * _framesPerBin)); // Bin boundaries don't drift even if the frame count is fractional.
+			_minimums.fill(0);
+			_maximums.fill(0);
+			_squares.fill(0);
+		}
+
+	private:
+		const double _framesPerBin;
+		std::vector<TrackEnvelope::Bin> _bins;
+		size_t _frame = 0;
+		size_t _binBegin = 0;
+		size_t _binEnd = 0;
+		alignas(32) std::array<float, kLanes> _minimums;
+		alignas(32) std::array<float, kLanes> _maximums;
+		alignas(32) std::array<float, kLanes> _squares;
+	};
+}
+
+WaveformAnalyzer::WaveformAnalyzer(QObject* parent)
+	: QObject{ parent }
+	, _thread{ [this] { run(); } }
+{
+}
+
+WaveformAnalyzer::~WaveformAnalyzer() noexcept
+{
+	{
+		std::lock_guard lock{ _mutex };
+		_stop = true;
+	}
+	_condition.notify_one();
+	_thread.join();
+}
+
+std::shared_ptr<const TrackEnvelope> WaveformAnalyzer::analyze(const void* trackId, const seir::synth::CompositionData& composition, const seir::synth::PartData& part, const std::shared_ptr<seir::synth::TrackData>& track)
+{
+	static const auto emptyEnvelope = std::make_shared<const TrackEnvelope>();
+	if (track->_fragments.empty())
+	{
+		_pendingKeys.erase(trackId);
+		return emptyEnvelope;
+	}
+
+	// The track is rendered alone at full weight and unit gain, so that the key depends only on the track itself.
+	seir::synth::CompositionData solo;
+	solo._speed = composition._speed;
+	solo._parts.emplace_back(std::make_shared<seir::synth::PartData>(part._voice))->_tracks.emplace_back(track);
+	auto packed = solo.pack();
+	if (!packed)
+		return emptyEnvelope;
+
+	const auto key = aulos::renderKey(*packed, kAnalysisFormat);
+	if (const auto i = _cache.find(key); i != _cache.end())
+	{
+		_pendingKeys.erase(trackId);
+		return i->second;
+	}
+	if (const auto [i, inserted] = _pendingKeys.emplace(trackId, key); !inserted)
+	{
+		if (i->second == key)
+			return {}; // The same contents are being analyzed already.
+		i->second = key;
+	}
+	{
+		std::lock_guard lock{ _mutex };
+		if (const auto i = std::find_if(_jobs.begin(), _jobs.end(), [trackId](const Job& job) { return job._trackId == trackId; }); i != _jobs.end())
+			_jobs.erase(i);
+		_jobs.emplace_back(Job{ trackId, key, composition._speed, std::move(packed) });
+	}
+	_condition.notify_one();
+	return {};
+}
+
+void WaveformAnalyzer::finish(const void* trackId, uint64_t key, const std::shared_ptr<const TrackEnvelope>& envelope)
+{
+	if (_cache.size() >= kMaxCacheSize)
+		_cache.clear();
+	_cache.emplace(key, envelope);
+	// The track may have been edited or removed while it was being analyzed.
+	if (const auto i = _pendingKeys.find(trackId); i != _pendingKeys.end() && i->second == key)
+	{
+		_pendingKeys.erase(i);
+		emit envelopeReady(trackId, envelope);
+	}
+}
+
+void WaveformAnalyzer::run()
+{
+	std::array<float, kBlockFrames> buffer;
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock lock{ _mutex };
+			_condition.wait(lock, [this] { return !_jobs.empty() || _stop; });
+			if (_stop)
+				return;
+			job = std::move(_jobs.front());
+			_jobs.erase(_jobs.begin());
+		}
+		const auto renderer = seir::synth::Renderer::create(*job._composition, kAnalysisFormat, false);
+		assert(renderer);
+		Decimator decimator{ static_cast<double>(kAnalysisFormat.samplingRate()) / (job._speed * TrackEnvelope::kBinsPerStep) };
+		bool superseded = false;
+		for (;;)
+		{
+			const auto frames = renderer->render(buffer.data(), buffer.size());
+			if (!frames)
+				break;
+			decimator.add(buffer.data(), frames);
+			// A newer job for the same track makes the current one useless.
+			std::lock_guard lock{ _mutex };
+			if (_stop || std::any_of(_jobs.cbegin(), _jobs.cend(), [&job](const Job& other) { return other._trackId == job._trackId; }))
+			{
+				superseded = true;
+				break;
+			}
+		}
+		if (superseded)
+			continue;
+		auto envelope = std::make_shared<TrackEnvelope>();
+		envelope->_bins = decimator.finish();
+		QMetaObject::invokeMethod(
+			this, [this, trackId = job._trackId, key = job._key, envelope = std::shared_ptr<const TrackEnvelope>{ std::move(envelope) }] { finish(trackId, key, envelope); }, Qt::QueuedConnection);
+	}
+}
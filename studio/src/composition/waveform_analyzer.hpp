@@ -0,0 +1,77 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+
+namespace seir::synth
+{
+	class Composition;
+	struct CompositionData;
+	struct PartData;
+	struct TrackData;
+}
+
+// Amplitude envelope of the track rendered alone at full weight and unit gain.
+struct TrackEnvelope
+{
+	static constexpr size_t kBinsPerStep = 4;
+
+	struct Bin
+	{
+		float _min = 0;
+		float _max = 0;
+		float _rms = 0;
+	};
+
+	std::vector<Bin> _bins;
+};
+
+// Renders tracks separately on a background thread and reduces their output to amplitude envelopes.
+// Envelopes are cached by the hash of the track contents, so unchanged tracks are never rendered twice.
+class WaveformAnalyzer final : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit WaveformAnalyzer(QObject* parent = nullptr);
+	~WaveformAnalyzer() noexcept override;
+
+	// Returns the envelope if the track with the same contents has been analyzed,
+	// otherwise queues the analysis, replacing the one queued for the track earlier.
+	std::shared_ptr<const TrackEnvelope> analyze(const void* trackId, const seir::synth::CompositionData&, const seir::synth::PartData&, const std::shared_ptr<seir::synth::TrackData>&);
+
+signals:
+	void envelopeReady(const void* trackId, const std::shared_ptr<const TrackEnvelope>&);
+
+private:
+	struct Job
+	{
+		const void* _trackId = nullptr;
+		uint64_t _key = 0;
+		unsigned _speed = 0;
+		std::unique_ptr<seir::synth::Composition> _composition;
+	};
+
+	void finish(const void* trackId, uint64_t key, const std::shared_ptr<const TrackEnvelope>&);
+	void run();
+
+private:
+	std::unordered_map<uint64_t, std::shared_ptr<const TrackEnvelope>> _cache; // Accessed only from the main thread.
+	std::unordered_map<const void*, uint64_t> _pendingKeys;                    // The latest requested keys, also accessed only from the main thread.
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::vector<Job> _jobs;
+	bool _stop = false;
+	std::thread _thread;
+};
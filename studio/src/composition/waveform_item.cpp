@@ -0,0 +1,99 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "waveform_item.hpp"
+
+#include "../theme.hpp"
+#include "waveform_analyzer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+WaveformItem::WaveformItem(QGraphicsItem* parent)
+	: QGraphicsItem{ parent }
+	, _stepWidth{ kStepWidth }
+{
+	setAcceptedMouseButtons(Qt::NoButton);
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF WaveformItem::boundingRect() const
+{
+	const auto binCount = _envelope ? _envelope->_bins.size() : 0;
+	return { 0, 0, binCount * _stepWidth / TrackEnvelope::kBinsPerStep, kWaveformLaneHeight };
+}
+
+void WaveformItem::setEnvelope(const std::shared_ptr<const TrackEnvelope>& envelope)
+{
+	prepareGeometryChange();
+	_envelope = envelope;
+}
+
+void WaveformItem::setGain(float gain)
+{
+	if (gain == _gain)
+		return;
+	_gain = gain;
+	update();
+}
+
+void WaveformItem::setStepWidth(qreal width)
+{
+	prepareGeometryChange();
+	_stepWidth = width;
+}
+
+void WaveformItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+	if (!_envelope || _envelope->_bins.empty())
+		return;
+	const auto& bins = _envelope->_bins;
+	const auto rect = boundingRect().intersected(option->exposedRect);
+	painter->setPen(Qt::NoPen);
+	painter->setBrush(kWaveformColors._brush);
+	painter->drawRect(rect);
+
+	// Bins narrower than a pixel are merged into pixel-wide columns.
+	const auto binWidth = _stepWidth / TrackEnvelope::kBinsPerStep;
+	const auto binsPerColumn = std::max<size_t>(1, static_cast<size_t>(std::ceil(1 / binWidth)));
+	const auto columnWidth = binsPerColumn * binWidth;
+	const auto center = kWaveformLaneHeight / 2;
+	const auto scale = center * _gain;
+	std::vector<QRectF> peaks;
+	std::vector<QRectF> rmses;
+	std::vector<QRectF> clips;
+	for (auto column = static_cast<size_t>(std::floor(rect.left() / columnWidth)); column * binsPerColumn < bins.size() && column * columnWidth < rect.right(); ++column)
+	{
+		const auto begin = bins.cbegin() + column * binsPerColumn;
+		const auto end = bins.cbegin() + std::min((column + 1) * binsPerColumn, bins.size());
+		auto minimum = begin->_min;
+		auto maximum = begin->_max;
+		auto rms = begin->_rms;
+		for (auto i = std::next(begin); i != end; ++i)
+		{
+			minimum = std::min(minimum, i->_min);
+			maximum = std::max(maximum, i->_max);
+			rms = std::max(rms, i->_rms);
+		}
+		const auto x = column * columnWidth;
+		const auto top = std::max(center - maximum * scale, qreal{ 0 });
+		const auto bottom = std::min(center - minimum * scale, kWaveformLaneHeight);
+		peaks.emplace_back(x, top, columnWidth, std::max(bottom - top, qreal{ 1 }));
+		if (const auto rmsHeight = std::min(rms * scale, center); rmsHeight > 0)
+			rmses.emplace_back(x, center - rmsHeight, columnWidth, 2 * rmsHeight);
+		if (std::max(maximum, -minimum) * _gain > 1)
+			clips.emplace_back(x, 0, columnWidth, kWaveformLaneHeight);
+	}
+	// Clipping is shown behind the envelope, so that the envelope remains visible.
+	painter->setBrush(kWaveformClipColor);
+	painter->drawRects(clips.data(), static_cast<int>(clips.size()));
+	painter->setBrush(kWaveformColors._pen);
+	painter->drawRects(peaks.data(), static_cast<int>(peaks.size()));
+	painter->setBrush(kWaveformRmsColor);
+	painter->drawRects(rmses.data(), static_cast<int>(rmses.size()));
+}
@@ -0,0 +1,31 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <memory>
+
+#include <QGraphicsItem>
+
+struct TrackEnvelope;
+
+// Shows the amplitude envelope of a track in a lane along the bottom of the track.
+class WaveformItem final : public QGraphicsItem
+{
+public:
+	explicit WaveformItem(QGraphicsItem* parent = nullptr);
+
+	QRectF boundingRect() const override;
+	void setEnvelope(const std::shared_ptr<const TrackEnvelope>&);
+	void setGain(float);
+	void setStepWidth(qreal);
+
+private:
+	void paint(QPainter*, const QStyleOptionGraphicsItem*, QWidget*) override;
+
+private:
+	std::shared_ptr<const TrackEnvelope> _envelope;
+	float _gain = 1; // Scales the envelope to the composition output.
+	qreal _stepWidth;
+};
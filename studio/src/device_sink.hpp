@@ -0,0 +1,24 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/sink.hpp>
+
+#include <QIODevice>
+
+// Makes a Qt device usable as an output for the core library.
+class DeviceSink final : public aulos::Sink
+{
+public:
+	explicit DeviceSink(QIODevice& device) noexcept
+		: _device{ device } {}
+
+	bool isSeekable() const noexcept override { return !_device.isSequential(); }
+	bool seek(uint64_t offset) override { return _device.seek(static_cast<qint64>(offset)); }
+	bool write(const void* data, size_t size) override { return _device.write(static_cast<const char*>(data), static_cast<qint64>(size)) == static_cast<qint64>(size); }
+
+private:
+	QIODevice& _device;
+};
@@ -0,0 +1,111 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "exporter.hpp"
+
+#include "device_sink.hpp"
+
+#include <aulos_core/composition.hpp>
+#include <aulos_core/render.hpp>
+
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include <QSaveFile>
+
+namespace
+{
+	constexpr std::chrono::milliseconds kProgressInterval{ 50 };
+}
+
+Exporter::Exporter(std::unique_ptr<seir::synth::Composition>&& composition, const seir::synth::AudioFormat& format, const QString& path, size_t blockSize, QObject* parent)
+	: QObject{ parent }
+	, _composition{ std::move(composition) }
+	, _format{ format }
+	, _path{ path }
+	, _blockSize{ std::max<size_t>(blockSize / _format.bytesPerFrame(), 1) * _format.bytesPerFrame() }
+{
+	assert(_composition);
+}
+
+Exporter::~Exporter()
+{
+	if (_thread.joinable())
+	{
+		_cancelled = true;
+		_thread.join();
+	}
+}
+
+void Exporter::start()
+{
+	assert(!_thread.joinable());
+	_thread = std::thread{ [this] { run(); } };
+}
+
+void Exporter::run()
+{
+	auto lastReport = std::chrono::steady_clock::now();
+	const auto reportProgress = [this, &lastReport](size_t renderedFrames, size_t totalFrames) {
+		if (const auto now = std::chrono::steady_clock::now(); now - lastReport >= kProgressInterval)
+		{
+			lastReport = now;
+			emit progressChanged(static_cast<double>(renderedFrames), static_cast<double>(totalFrames));
+		}
+	};
+
+	size_t measuredFrames = 0;
+	const auto amplitude = aulos::measureAmplitude(*_composition, [this, &reportProgress, &measuredFrames](size_t frames) {
+		measuredFrames = frames;
+		reportProgress(frames * _format.samplingRate() / seir::synth::Renderer::kMaxSamplingRate, 0);
+		return !_cancelled;
+	});
+	if (!amplitude)
+	{
+		emit finished(false, {});
+		return;
+	}
+
+	const auto composition = aulos::normalizeComposition(*_composition, *amplitude);
+	assert(composition);
+
+	QSaveFile file{ _path };
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		emit finished(false, file.errorString());
+		return;
+	}
+
+	// The measurement is done at a different sampling rate, so the total is approximate.
+	const auto totalFrames = measuredFrames * _format.samplingRate() / seir::synth::Renderer::kMaxSamplingRate;
+	aulos::RenderOptions options;
+	options._blockSize = _blockSize;
+	options._progressCallback = [this, &reportProgress, totalFrames](size_t renderedFrames) {
+		reportProgress(renderedFrames, std::max(totalFrames, renderedFrames));
+		return !_cancelled;
+	};
+	DeviceSink sink{ file };
+	switch (aulos::render(*composition, _format, sink, options))
+	{
+	case aulos::RenderStatus::Completed:
+		if (!file.commit())
+			break;
+		emit finished(true, {});
+		return;
+	case aulos::RenderStatus::Cancelled:
+		file.cancelWriting();
+		emit finished(false, {});
+		return;
+	case aulos::RenderStatus::Failed: {
+		const auto errorString = file.errorString();
+		file.cancelWriting();
+		emit finished(false, errorString);
+		return;
+	}
+	}
+	emit finished(false, file.errorString());
+}
@@ -0,0 +1,50 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <seir_synth/format.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <QObject>
+
+namespace seir::synth
+{
+	class Composition;
+}
+
+// Renders a composition into a WAV file on a background thread.
+class Exporter final : public QObject
+{
+	Q_OBJECT
+
+public:
+	// The composition must be packed with unit gain divisor, the exporter measures and applies the gain itself.
+	// Rendered data is written to the file in blocks of the specified size (rounded down to whole frames).
+	Exporter(std::unique_ptr<seir::synth::Composition>&&, const seir::synth::AudioFormat&, const QString& path, size_t blockSize, QObject* parent = nullptr);
+	~Exporter() override;
+
+	void cancel() noexcept { _cancelled = true; }
+	const QString& path() const noexcept { return _path; }
+	void start();
+
+signals:
+	// Total frame count is zero until the gain measurement is finished.
+	void progressChanged(double renderedFrames, double totalFrames);
+	void finished(bool success, const QString& errorString);
+
+private:
+	void run();
+
+private:
+	const std::unique_ptr<seir::synth::Composition> _composition;
+	const seir::synth::AudioFormat _format;
+	const QString _path;
+	const size_t _blockSize;
+	std::atomic<bool> _cancelled{ false };
+	std::thread _thread;
+};
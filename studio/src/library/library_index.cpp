@@ -0,0 +1,268 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "library_index.hpp"
+
+#include <aulos_core/composition.hpp>
+
+#include <seir_synth/data.hpp>
+#include <seir_synth/renderer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+	constexpr quint32 kIndexSignature = 0x42494c41; // "ALIB".
+	constexpr quint32 kIndexVersion = 1;
+
+	// Thumbnails are rendered at a low sampling rate which is enough to see the loudness.
+	constexpr unsigned kThumbnailSamplingRate = 8'000;
+	constexpr size_t kThumbnailBlockFrames = kThumbnailSamplingRate / 10;
+	constexpr int kThumbnailSize = 64;
+
+	constexpr std::chrono::milliseconds kPostInterval{ 100 };
+
+	QDataStream& operator<<(QDataStream& stream, const LibraryEntry& entry)
+	{
+		return stream << entry._path << entry._size << entry._modified << entry._error << entry._title << entry._author
+					  << quint32{ entry._speed } << entry._duration << quint32{ entry._voices } << quint32{ entry._tracks } << entry._thumbnail;
+	}
+
+	QDataStream& operator>>(QDataStream& stream, LibraryEntry& entry)
+	{
+		quint32 speed = 0;
+		quint32 voices = 0;
+		quint32 tracks = 0;
+		stream >> entry._path >> entry._size >> entry._modified >> entry._error >> entry._title >> entry._author >> speed >> entry._duration >> voices >> tracks >> entry._thumbnail;
+		entry._speed = speed;
+		entry._voices = voices;
+		entry._tracks = tracks;
+		return stream;
+	}
+
+	QHash<QString, LibraryEntry> loadIndex(const QString& path)
+	{
+		QHash<QString, LibraryEntry> result;
+		QFile file{ path };
+		if (!file.open(QIODevice::ReadOnly))
+			return result;
+		QDataStream stream{ &file };
+		stream.setVersion(QDataStream::Qt_5_15);
+		quint32 signature = 0;
+		quint32 version = 0;
+		quint32 count = 0;
+		stream >> signature >> version >> count;
+		if (signature != kIndexSignature || version != kIndexVersion)
+			return result;
+		for (quint32 i = 0; i < count; ++i)
+		{
+			LibraryEntry entry;
+			stream >> entry;
+			if (stream.status() != QDataStream::Ok)
+				return {};
+			result.insert(entry._path, std::move(entry));
+		}
+		return result;
+	}
+
+	void saveIndex(const QString& path, const QHash<QString, LibraryEntry>& index)
+	{
+		QSaveFile file{ path };
+		if (!file.open(QIODevice::WriteOnly))
+			return;
+		QDataStream stream{ &file };
+		stream.setVersion(QDataStream::Qt_5_15);
+		stream << kIndexSignature << kIndexVersion << static_cast<quint32>(index.size());
+		for (const auto& entry : index)
+			stream << entry;
+		if (stream.status() == QDataStream::Ok)
+			file.commit();
+	}
+
+	// Returns an empty optional if cancelled.
+	std::optional<LibraryEntry> makeEntry(const QFileInfo& info, const std::atomic<bool>& cancelled)
+	{
+		LibraryEntry entry;
+		entry._path = info.filePath();
+		entry._size = info.size();
+		entry._modified = info.lastModified().toMSecsSinceEpoch();
+
+		std::string error;
+		const auto data = aulos::loadCompositionData(std::filesystem::path{ entry._path.toStdU16String() }, error);
+		if (!data)
+		{
+			entry._error = QString::fromStdString(error);
+			return entry;
+		}
+		entry._title = QString::fromStdString(data->_title);
+		entry._author = QString::fromStdString(data->_author);
+		entry._speed = data->_speed;
+		entry._voices = static_cast<unsigned>(data->_parts.size());
+		entry._tracks = std::accumulate(data->_parts.cbegin(), data->_parts.cend(), 0u, [](unsigned count, const auto& part) { return count + static_cast<unsigned>(part->_tracks.size()); });
+
+		const auto composition = data->pack();
+		if (!composition)
+		{
+			entry._error = QStringLiteral("Invalid composition");
+			return entry;
+		}
+		const auto renderer = seir::synth::Renderer::create(*composition, { kThumbnailSamplingRate, seir::synth::ChannelLayout::Mono }, false);
+		if (!renderer)
+		{
+			entry._error = QStringLiteral("Unable to render composition");
+			return entry;
+		}
+		std::vector<float> peaks;
+		size_t totalFrames = 0;
+		for (std::array<float, kThumbnailBlockFrames> buffer;;)
+		{
+			if (cancelled)
+				return {};
+			const auto frames = renderer->render(buffer.data(), buffer.size());
+			if (!frames)
+				break;
+			const auto minmax = std::minmax_element(buffer.cbegin(), buffer.cbegin() + frames);
+			peaks.emplace_back(std::max(-*minmax.first, *minmax.second));
+			totalFrames += frames;
+		}
+		entry._duration = static_cast<double>(totalFrames) / kThumbnailSamplingRate;
+		if (const auto maxPeak = peaks.empty() ? 0.f : *std::max_element(peaks.cbegin(), peaks.cend()); maxPeak > 0)
+		{
+			entry._thumbnail.resize(kThumbnailSize);
+			for (int i = 0; i < kThumbnailSize; ++i)
+			{
+				const auto begin = peaks.cbegin() + i * peaks.size() / kThumbnailSize;
+				const auto end = std::max(peaks.cbegin() + (i + 1) * peaks.size() / kThumbnailSize, std::next(begin));
+				entry._thumbnail[i] = static_cast<char>(std::lround(*std::max_element(begin, end) / maxPeak * 255));
+			}
+		}
+		return entry;
+	}
+}
+
+LibraryIndex::LibraryIndex(QObject* parent)
+	: QObject{ parent }
+	, _indexPath{ QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/library.index") }
+{
+	QDir{}.mkpath(QFileInfo{ _indexPath }.path());
+}
+
+LibraryIndex::~LibraryIndex()
+{
+	stop();
+}
+
+void LibraryIndex::start(const QStringList& folders)
+{
+	stop();
+	_cancelled = false;
+	_finished = false;
+	{
+		std::lock_guard lock{ _mutex };
+		_updates = {};
+	}
+	_thread = std::thread{ [this, folders] { run(folders); } };
+}
+
+LibraryIndex::Updates LibraryIndex::takeUpdates()
+{
+	std::lock_guard lock{ _mutex };
+	return std::exchange(_updates, {});
+}
+
+void LibraryIndex::post(std::vector<LibraryEntry>&& entries, QStringList&& removed)
+{
+	if (entries.empty() && removed.isEmpty())
+		return;
+	bool wasEmpty = false;
+	{
+		std::lock_guard lock{ _mutex };
+		wasEmpty = _updates._entries.empty() && _updates._removed.isEmpty();
+		std::move(entries.begin(), entries.end(), std::back_inserter(_updates._entries));
+		_updates._removed += removed;
+	}
+	entries.clear();
+	removed.clear();
+	if (wasEmpty)
+		emit updated(); // Updates are collected until the receiver takes them.
+}
+
+void LibraryIndex::run(const QStringList& folders)
+{
+	const auto isInLibrary = [&folders](const QString& path) {
+		return std::any_of(folders.cbegin(), folders.cend(), [&path](const QString& folder) { return path.startsWith(folder + '/'); });
+	};
+
+	const auto cached = ::loadIndex(_indexPath);
+	std::vector<LibraryEntry> entries;
+	for (const auto& entry : cached)
+		if (isInLibrary(entry._path))
+			entries.emplace_back(entry);
+	post(std::move(entries), {});
+
+	QHash<QString, LibraryEntry> index;
+	auto lastPost = std::chrono::steady_clock::now();
+	for (const auto& folder : folders)
+	{
+		for (QDirIterator i{ folder, { QStringLiteral("*.aulos"), QStringLiteral("*.aulosb") }, QDir::Files, QDirIterator::Subdirectories }; i.hasNext();)
+		{
+			if (_cancelled)
+				return;
+			i.next();
+			const auto info = i.fileInfo();
+			const auto path = info.filePath();
+			if (index.contains(path))
+				continue; // The folders may be nested.
+			if (const auto cachedIt = cached.find(path); cachedIt != cached.end() && cachedIt->_size == info.size() && cachedIt->_modified == info.lastModified().toMSecsSinceEpoch())
+			{
+				index.insert(path, *cachedIt);
+				continue;
+			}
+			auto entry = ::makeEntry(info, _cancelled);
+			if (!entry)
+				return;
+			index.insert(path, *entry);
+			entries.emplace_back(std::move(*entry));
+			if (const auto now = std::chrono::steady_clock::now(); now - lastPost >= kPostInterval)
+			{
+				lastPost = now;
+				post(std::move(entries), {});
+			}
+		}
+	}
+	QStringList removed;
+	for (const auto& entry : cached)
+		if (isInLibrary(entry._path) && !index.contains(entry._path))
+			removed << entry._path;
+	post(std::move(entries), std::move(removed));
+	::saveIndex(_indexPath, index);
+	_finished = true;
+	emit finished();
+}
+
+void LibraryIndex::stop()
+{
+	if (_thread.joinable())
+	{
+		_cancelled = true;
+		_thread.join();
+	}
+}
@@ -0,0 +1,71 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QByteArray>
+#include <QObject>
+#include <QStringList>
+
+// Composition metadata stored in the library index.
+struct LibraryEntry
+{
+	QString _path;
+	qint64 _size = 0;
+	qint64 _modified = 0; // Milliseconds since epoch.
+	QString _error;       // Empty if the file was loaded successfully.
+	QString _title;
+	QString _author;
+	unsigned _speed = 0;
+	double _duration = 0; // Seconds.
+	unsigned _voices = 0;
+	unsigned _tracks = 0;
+	QByteArray _thumbnail; // Peak amplitudes of consecutive parts of the composition, 255 being the loudest.
+};
+
+// Indexes compositions in the specified folders on a background thread.
+// The index is cached in a file, and only new or modified (by size or time) compositions are loaded.
+class LibraryIndex final : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Updates
+	{
+		std::vector<LibraryEntry> _entries; // New or updated entries.
+		QStringList _removed;               // Paths of the entries which are no longer in the library.
+	};
+
+	explicit LibraryIndex(QObject* parent = nullptr);
+	~LibraryIndex() override;
+
+	bool isIndexing() const noexcept { return _thread.joinable() && !_finished; }
+	// Starts indexing the folders, cancelling the indexing which is in progress.
+	// All the entries are reported as updated, the cached ones come first.
+	void start(const QStringList& folders);
+	// Returns the updates since the last call, may be called while indexing is in progress.
+	Updates takeUpdates();
+
+signals:
+	void finished();
+	void updated();
+
+private:
+	void post(std::vector<LibraryEntry>&&, QStringList&& removed);
+	void run(const QStringList& folders);
+	void stop();
+
+private:
+	const QString _indexPath;
+	std::mutex _mutex;
+	Updates _updates;
+	std::atomic<bool> _cancelled{ false };
+	std::atomic<bool> _finished{ false };
+	std::thread _thread;
+};
@@ -0,0 +1,242 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "library_widget.hpp"
+
+#include "library_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMenu>
+#include <QPainter>
+#include <QSettings>
+#include <QStyledItemDelegate>
+#include <QToolButton>
+#include <QTreeWidget>
+
+namespace
+{
+	const auto kLibraryFoldersKey = QStringLiteral("LibraryFolders");
+
+	enum Column
+	{
+		kThumbnailColumn,
+		kTitleColumn,
+		kAuthorColumn,
+		kDurationColumn,
+		kVoicesColumn,
+		kTracksColumn,
+		kSpeedColumn,
+		kColumnCount,
+	};
+
+	constexpr int kThumbnailRole = Qt::UserRole;
+	constexpr int kSortRole = Qt::UserRole + 1;
+	constexpr int kPathRole = Qt::UserRole + 2;
+
+	constexpr int kThumbnailWidth = 64;
+	constexpr int kThumbnailHeight = 16;
+
+	class LibraryItem final : public QTreeWidgetItem
+	{
+	public:
+		bool operator<(const QTreeWidgetItem& other) const override
+		{
+			const auto column = treeWidget()->sortColumn();
+			if (const auto value = data(column, kSortRole); value.isValid())
+				return value.toDouble() < other.data(column, kSortRole).toDouble();
+			return text(column).compare(other.text(column), Qt::CaseInsensitive) < 0;
+		}
+	};
+
+	class ThumbnailDelegate final : public QStyledItemDelegate
+	{
+	public:
+		using QStyledItemDelegate::QStyledItemDelegate;
+
+		void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override
+		{
+			QStyledItemDelegate::paint(painter, option, index);
+			const auto peaks = index.data(kThumbnailRole).toByteArray();
+			if (peaks.isEmpty())
+				return;
+			const auto rect = option.rect.adjusted(2, 2, -2, -2);
+			const auto barWidth = static_cast<qreal>(rect.width()) / peaks.size();
+			const auto middle = rect.center().y() + 0.5;
+			painter->save();
+			painter->setPen(Qt::NoPen);
+			painter->setBrush(option.palette.color(option.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text));
+			for (int i = 0; i < peaks.size(); ++i)
+			{
+				const auto height = std::max(static_cast<uint8_t>(peaks[i]) * rect.height() / 255.0, 1.0);
+				painter->drawRect(QRectF{ rect.left() + i * barWidth, middle - height / 2, barWidth, height });
+			}
+			painter->restore();
+		}
+
+		QSize sizeHint(const QStyleOptionViewItem&, const QModelIndex&) const override
+		{
+			return { kThumbnailWidth + 4, kThumbnailHeight + 4 };
+		}
+	};
+
+	QString formatDuration(double seconds)
+	{
+		const auto totalSeconds = static_cast<int>(std::lround(seconds));
+		return QStringLiteral("%1:%2").arg(totalSeconds / 60).arg(totalSeconds % 60, 2, 10, QLatin1Char{ '0' });
+	}
+}
+
+LibraryWidget::LibraryWidget(QWidget* parent)
+	: QWidget{ parent }
+	, _index{ new LibraryIndex{ this } }
+{
+	const auto layout = new QGridLayout{ this };
+	layout->setContentsMargins({});
+
+	_filterEdit = new QLineEdit{ this };
+	_filterEdit->setClearButtonEnabled(true);
+	_filterEdit->setPlaceholderText(tr("Filter"));
+	layout->addWidget(_filterEdit, 0, 0);
+	connect(_filterEdit, &QLineEdit::textChanged, [this] {
+		for (const auto item : _items)
+			applyFilter(item);
+	});
+
+	const auto foldersButton = new QToolButton{ this };
+	foldersButton->setText(tr("Folders"));
+	foldersButton->setPopupMode(QToolButton::InstantPopup);
+	const auto foldersMenu = new QMenu{ foldersButton };
+	foldersButton->setMenu(foldersMenu);
+	connect(foldersMenu, &QMenu::aboutToShow, [this, foldersMenu] {
+		foldersMenu->clear();
+		foldersMenu->addAction(tr("Add Folder..."), [this] {
+			if (const auto path = QFileDialog::getExistingDirectory(this, tr("Add Library Folder")); !path.isNull() && !_folders.contains(QDir::cleanPath(path)))
+				setFolders(_folders + QStringList{ QDir::cleanPath(path) });
+		});
+		foldersMenu->addAction(tr("Rescan"), [this] { rescan(); })->setEnabled(!_folders.isEmpty());
+		if (!_folders.isEmpty())
+			foldersMenu->addSeparator();
+		for (const auto& folder : _folders)
+			foldersMenu->addAction(tr("Remove %1").arg(QDir::toNativeSeparators(folder)), [this, folder] {
+				auto folders = _folders;
+				folders.removeOne(folder);
+				setFolders(folders);
+			});
+	});
+	layout->addWidget(foldersButton, 0, 1);
+
+	_tree = new QTreeWidget{ this };
+	_tree->setColumnCount(kColumnCount);
+	_tree->setHeaderLabels({ {}, tr("Title"), tr("Author"), tr("Duration"), tr("Voices"), tr("Tracks"), tr("Speed") });
+	_tree->setItemDelegateForColumn(kThumbnailColumn, new ThumbnailDelegate{ _tree });
+	_tree->setRootIsDecorated(false);
+	_tree->setUniformRowHeights(true);
+	_tree->setSortingEnabled(true);
+	_tree->sortByColumn(kTitleColumn, Qt::AscendingOrder);
+	_tree->header()->setSectionResizeMode(kThumbnailColumn, QHeaderView::Fixed);
+	_tree->header()->resizeSection(kThumbnailColumn, kThumbnailWidth + 4);
+	layout->addWidget(_tree, 1, 0, 1, 2);
+	connect(_tree, &QTreeWidget::itemActivated, [this](QTreeWidgetItem* item) { emit openRequested(item->data(kTitleColumn, kPathRole).toString()); });
+
+	_statusLabel = new QLabel{ this };
+	layout->addWidget(_statusLabel, 2, 0, 1, 2);
+
+	connect(_index, &LibraryIndex::updated, this, &LibraryWidget::takeUpdates);
+	connect(_index, &LibraryIndex::finished, this, &LibraryWidget::updateStatus);
+
+	_folders = QSettings{}.value(kLibraryFoldersKey).toStringList();
+	rescan();
+}
+
+LibraryWidget::~LibraryWidget() = default;
+
+void LibraryWidget::applyFilter(QTreeWidgetItem* item) const
+{
+	const auto filter = _filterEdit->text();
+	item->setHidden(!filter.isEmpty()
+		&& !item->text(kTitleColumn).contains(filter, Qt::CaseInsensitive)
+		&& !item->text(kAuthorColumn).contains(filter, Qt::CaseInsensitive)
+		&& !item->data(kTitleColumn, kPathRole).toString().contains(filter, Qt::CaseInsensitive));
+}
+
+void LibraryWidget::rescan()
+{
+	_items.clear();
+	_tree->clear();
+	if (!_folders.isEmpty())
+		_index->start(_folders);
+	updateStatus();
+}
+
+void LibraryWidget::setFolders(const QStringList& folders)
+{
+	_folders = folders;
+	QSettings{}.setValue(kLibraryFoldersKey, _folders);
+	rescan();
+}
+
+void LibraryWidget::takeUpdates()
+{
+	auto updates = _index->takeUpdates();
+	// Sorting is suspended so that the items aren't moved on every change.
+	_tree->setSortingEnabled(false);
+	for (const auto& path : updates._removed)
+		delete _items.take(path);
+	for (auto& entry : updates._entries)
+	{
+		auto& item = _items[entry._path];
+		if (!item)
+		{
+			item = new LibraryItem;
+			_tree->addTopLevelItem(item);
+		}
+		item->setData(kThumbnailColumn, kThumbnailRole, entry._thumbnail);
+		item->setText(kTitleColumn, entry._title.isEmpty() ? QFileInfo{ entry._path }.completeBaseName() : entry._title);
+		item->setData(kTitleColumn, kPathRole, entry._path);
+		item->setText(kAuthorColumn, entry._author);
+		item->setToolTip(kTitleColumn, entry._error.isEmpty() ? QDir::toNativeSeparators(entry._path) : QStringLiteral("%1\n%2").arg(QDir::toNativeSeparators(entry._path), entry._error));
+		if (entry._error.isEmpty())
+		{
+			item->setText(kDurationColumn, ::formatDuration(entry._duration));
+			item->setData(kDurationColumn, kSortRole, entry._duration);
+			item->setText(kVoicesColumn, QString::number(entry._voices));
+			item->setData(kVoicesColumn, kSortRole, entry._voices);
+			item->setText(kTracksColumn, QString::number(entry._tracks));
+			item->setData(kTracksColumn, kSortRole, entry._tracks);
+			item->setText(kSpeedColumn, QString::number(entry._speed));
+			item->setData(kSpeedColumn, kSortRole, entry._speed);
+		}
+		else
+		{
+			for (const auto column : { kDurationColumn, kVoicesColumn, kTracksColumn, kSpeedColumn })
+			{
+				item->setText(column, {});
+				item->setData(column, kSortRole, {});
+			}
+		}
+		item->setDisabled(!entry._error.isEmpty());
+		applyFilter(item);
+	}
+	_tree->setSortingEnabled(true);
+	updateStatus();
+}
+
+void LibraryWidget::updateStatus()
+{
+	if (_folders.isEmpty())
+		_statusLabel->setText(tr("Add folders to the library to see their compositions here."));
+	else if (_index->isIndexing())
+		_statusLabel->setText(tr("Indexing: %L1 compositions").arg(_items.size()));
+	else
+		_statusLabel->setText(tr("%L1 compositions").arg(_items.size()));
+}
@@ -0,0 +1,43 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <QHash>
+#include <QWidget>
+
+class QLabel;
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+class LibraryIndex;
+
+// Lists compositions from the library folders.
+class LibraryWidget final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit LibraryWidget(QWidget* parent);
+	~LibraryWidget() override;
+
+signals:
+	void openRequested(const QString& path);
+
+private:
+	void applyFilter(QTreeWidgetItem*) const;
+	void rescan();
+	void setFolders(const QStringList&);
+	void takeUpdates();
+	void updateStatus();
+
+private:
+	LibraryIndex* const _index;
+	QStringList _folders;
+	QLineEdit* _filterEdit;
+	QTreeWidget* _tree;
+	QLabel* _statusLabel;
+	QHash<QString, QTreeWidgetItem*> _items;
+};
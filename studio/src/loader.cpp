@@ -0,0 +1,37 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "loader.hpp"
+
+#include <seir_synth/data.hpp>
+
+#include <cassert>
+#include <filesystem>
+#include <string>
+
+Loader::Loader(const QString& path, QObject* parent)
+	: QObject{ parent }
+	, _path{ path }
+{
+}
+
+Loader::~Loader()
+{
+	// Loading can't be interrupted, but it's short enough to simply wait for it.
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void Loader::start()
+{
+	assert(!_thread.joinable());
+	_thread = std::thread{ [this] { run(); } };
+}
+
+void Loader::run()
+{
+	std::string error;
+	_composition = aulos::loadCompositionData(std::filesystem::path{ _path.toStdU16String() }, error, &_timings);
+	emit finished(static_cast<bool>(_composition), QString::fromStdString(error));
+}
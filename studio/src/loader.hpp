@@ -0,0 +1,45 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/composition.hpp>
+
+#include <memory>
+#include <thread>
+
+#include <QObject>
+
+namespace seir::synth
+{
+	struct CompositionData;
+}
+
+// Loads a composition file on a background thread.
+class Loader final : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit Loader(const QString& path, QObject* parent = nullptr);
+	~Loader() override;
+
+	// The composition and timings are only valid after the loader has finished.
+	const std::shared_ptr<seir::synth::CompositionData>& composition() const noexcept { return _composition; }
+	const QString& path() const noexcept { return _path; }
+	void start();
+	const aulos::LoadTimings& timings() const noexcept { return _timings; }
+
+signals:
+	void finished(bool success, const QString& errorString);
+
+private:
+	void run();
+
+private:
+	const QString _path;
+	std::shared_ptr<seir::synth::CompositionData> _composition;
+	aulos::LoadTimings _timings;
+	std::thread _thread;
+};
@@ -0,0 +1,154 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pcm_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QDateTime>
+#include <QFile>
+#include <QSettings>
+#include <QStandardPaths>
+
+namespace
+{
+	const QString kPcmCacheSizeKey = QStringLiteral("PcmCacheSize");
+
+	constexpr qint64 kDefaultPcmCacheSize = qint64{ 1 } << 30;
+
+	// Holds about ten seconds of stereo data at 48 kHz, so the recording is dropped only if the disk stalls for that long.
+	constexpr size_t kRecorderBufferSize = size_t{ 1 } << 22;
+	constexpr std::chrono::milliseconds kRecorderPollInterval{ 10 };
+
+	QString cacheFileName(uint64_t key)
+	{
+		return QStringLiteral("%1.pcm").arg(key, 16, 16, QLatin1Char{ '0' });
+	}
+}
+
+PcmRecorder::Input::Input()
+	: _buffer{ std::make_unique<std::byte[]>(kRecorderBufferSize) }
+{
+}
+
+void PcmRecorder::Input::close() noexcept
+{
+	auto expected = State::Recording;
+	_state.compare_exchange_strong(expected, State::Closed);
+}
+
+void PcmRecorder::Input::drop() noexcept
+{
+	auto expected = State::Recording;
+	_state.compare_exchange_strong(expected, State::Dropped);
+}
+
+void PcmRecorder::Input::write(const float* data, size_t samples) noexcept
+{
+	if (_state.load(std::memory_order_relaxed) != State::Recording)
+		return;
+	const auto size = samples * sizeof *data;
+	const auto writeOffset = _writeOffset.load(std::memory_order_relaxed);
+	if (size > kRecorderBufferSize - (writeOffset - _readOffset.load(std::memory_order_acquire)))
+	{
+		drop(); // Waiting for the writing thread would stall the playback.
+		return;
+	}
+	const auto position = writeOffset % kRecorderBufferSize;
+	const auto chunk = std::min(size, kRecorderBufferSize - position);
+	std::memcpy(_buffer.get() + position, data, chunk);
+	std::memcpy(_buffer.get(), reinterpret_cast<const std::byte*>(data) + chunk, size - chunk);
+	_writeOffset.store(writeOffset + size, std::memory_order_release);
+}
+
+PcmRecorder::PcmRecorder(const std::filesystem::path& path)
+	: _sink{ path }
+	, _input{ std::make_shared<Input>() }
+{
+	if (_sink.isOpen())
+		_thread = std::thread{ [this] { run(); } };
+	else
+		_input->drop();
+}
+
+PcmRecorder::~PcmRecorder() noexcept
+{
+	_stop.store(true);
+	if (_thread.joinable())
+		_thread.join();
+}
+
+bool PcmRecorder::commit()
+{
+	if (_thread.joinable())
+	{
+		if (isRecording())
+			_stop.store(true);
+		_thread.join();
+	}
+	return !_failed && _input->_state.load() == Input::State::Closed && _sink.commit();
+}
+
+void PcmRecorder::run()
+{
+	while (!_stop.load())
+	{
+		// The state is loaded before the offset, so the data written before closing is never missed.
+		const auto state = _input->_state.load(std::memory_order_acquire);
+		if (state == Input::State::Dropped)
+			return;
+		const auto writeOffset = _input->_writeOffset.load(std::memory_order_acquire);
+		const auto readOffset = _input->_readOffset.load(std::memory_order_relaxed);
+		if (writeOffset == readOffset)
+		{
+			if (state == Input::State::Closed)
+				return;
+			std::this_thread::sleep_for(kRecorderPollInterval);
+			continue;
+		}
+		const auto position = readOffset % kRecorderBufferSize;
+		const auto size = std::min(writeOffset - readOffset, kRecorderBufferSize - position);
+		if (!_sink.write(_input->_buffer.get() + position, size))
+		{
+			_failed = true;
+			_input->drop();
+			return;
+		}
+		_input->_readOffset.store(readOffset + size, std::memory_order_release);
+	}
+}
+
+PcmCache::PcmCache()
+	: _directory{ QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pcm") }
+{
+	_directory.mkpath(QStringLiteral("."));
+}
+
+std::unique_ptr<QFile> PcmCache::find(uint64_t key) const
+{
+	auto file = std::make_unique<QFile>(_directory.filePath(::cacheFileName(key)));
+	if (!file->open(QIODevice::ReadOnly))
+		return {};
+	file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime); // Marks the file as recently used.
+	return file;
+}
+
+std::unique_ptr<PcmRecorder> PcmCache::record(uint64_t key) const
+{
+	return std::make_unique<PcmRecorder>(std::filesystem::path{ _directory.filePath(::cacheFileName(key)).toStdU16String() });
+}
+
+void PcmCache::trim() const
+{
+	const auto maxSize = QSettings{}.value(kPcmCacheSizeKey, kDefaultPcmCacheSize).toLongLong();
+	qint64 totalSize = 0;
+	for (const auto& info : _directory.entryInfoList({ QStringLiteral("*.pcm") }, QDir::Files, QDir::Time))
+	{
+		totalSize += info.size();
+		if (totalSize > maxSize)
+			QFile::remove(info.filePath());
+	}
+}
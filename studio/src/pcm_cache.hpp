@@ -0,0 +1,90 @@
+// This file is part of the Aulos toolkit.
+// Copyright (C) Sergei Blagodarin.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <aulos_core/sink.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include <QDir>
+
+class QFile;
+
+// Collects rendered data for the cache.
+// The audio thread copies the data into a ring buffer and a background thread writes it into the file.
+// The data becomes available in the cache only if it is committed, i. e. the whole composition was recorded.
+class PcmRecorder
+{
+public:
+	// The part of the recorder used by the audio thread, none of its functions block.
+	class Input
+	{
+	public:
+		Input();
+
+		// Marks the end of the composition.
+		void close() noexcept;
+		// Discards the recording.
+		void drop() noexcept;
+		// Appends interleaved samples, drops the recording if they don't fit into the buffer.
+		void write(const float* data, size_t samples) noexcept;
+
+	private:
+		enum class State
+		{
+			Recording,
+			Closed,
+			Dropped,
+		};
+
+		const std::unique_ptr<std::byte[]> _buffer;
+		std::atomic<size_t> _readOffset{ 0 }; // Offsets grow monotonically, the position in the buffer is the offset modulo the buffer size.
+		std::atomic<size_t> _writeOffset{ 0 };
+		std::atomic<State> _state{ State::Recording };
+		friend PcmRecorder;
+	};
+
+	explicit PcmRecorder(const std::filesystem::path&);
+	~PcmRecorder() noexcept;
+
+	// Waits for the remaining data to be written and adds the file to the cache.
+	// Returns false if the recording wasn't complete, in which case the file is discarded.
+	bool commit();
+	const std::shared_ptr<Input>& input() const noexcept { return _input; }
+	// Returns true if the input hasn't been closed or dropped yet.
+	bool isRecording() const noexcept { return _input->_state.load() == Input::State::Recording; }
+
+private:
+	void run();
+
+private:
+	aulos::FileSink _sink;
+	const std::shared_ptr<Input> _input;
+	std::atomic<bool> _stop{ false };
+	bool _failed = false; // Accessed only from the writing thread until it is joined.
+	std::thread _thread;
+};
+
+// Stores rendered compositions as raw PCM files, keyed by aulos::renderKey().
+class PcmCache
+{
+public:
+	PcmCache();
+
+	// Opens cached data for reading, returns null if there is no data for the key.
+	std::unique_ptr<QFile> find(uint64_t key) const;
+	// Starts recording data for the key.
+	std::unique_ptr<PcmRecorder> record(uint64_t key) const;
+	// Removes the least recently used data so that the total size fits the limit set in the settings.
+	// Data being recorded isn't counted until it is committed, so the cache should be trimmed after every commit.
+	void trim() const;
+
+private:
+	const QDir _directory;
+};
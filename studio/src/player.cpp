@@ -4,30 +4,45 @@
 
 #include "player.hpp"
 
+#include "pcm_cache.hpp"
+
 #include <seir_audio/decoder.hpp>
 #include <seir_synth/format.hpp>
 #include <seir_synth/renderer.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cstring>
 #include <mutex>
 
 #include <QDebug>
+#include <QFile>
 
-class AudioDecoder final : public seir::AudioDecoder
+class AudioDecoder : public seir::AudioDecoder
 {
 public:
-	AudioDecoder(std::unique_ptr<seir::synth::Renderer>&& renderer, size_t baseOffset, size_t minBufferFrames)
-		: _renderer{ std::move(renderer) }
-		, _baseOffset{ baseOffset }
+	virtual size_t currentOffset() const noexcept = 0;
+
+protected:
+	AudioDecoder(const seir::synth::AudioFormat& format, size_t minBufferFrames) noexcept
+		: _format{ format }
 		, _minRemainingFrames{ minBufferFrames }
 	{
-		_renderer->skipFrames(_baseOffset); // TODO: Remove extra skip.
 	}
 
-	auto currentOffset() const noexcept
+	// Pads the output with silence until the minimum buffer size is reached.
+	size_t padOutput(void* buffer, size_t frames, size_t maxFrames) noexcept
 	{
-		std::lock_guard lock{ _mutex };
-		return _renderer->currentOffset();
+		_minRemainingFrames -= std::min(_minRemainingFrames, frames);
+		if (frames < maxFrames && _minRemainingFrames > 0)
+		{
+			const auto paddingFrames = std::min(maxFrames - frames, _minRemainingFrames);
+			std::memset(static_cast<float*>(buffer) + frames * _format.channelCount(), 0, paddingFrames * _format.bytesPerFrame());
+			frames += paddingFrames;
+			_minRemainingFrames -= paddingFrames;
+		}
+		return frames;
 	}
 
 private:
@@ -40,35 +55,116 @@ private:
 		};
 	}
 
+protected:
+	const seir::synth::AudioFormat _format;
+
+private:
+	size_t _minRemainingFrames = 0;
+};
+
+class RendererDecoder final : public AudioDecoder
+{
+public:
+	RendererDecoder(std::unique_ptr<seir::synth::Renderer>&& renderer, size_t baseOffset, size_t minBufferFrames, Player& player, const std::shared_ptr<PcmRecorder::Input>& recording)
+		: AudioDecoder{ renderer->format(), minBufferFrames }
+		, _renderer{ std::move(renderer) }
+		, _baseOffset{ baseOffset }
+		, _player{ player }
+		, _recording{ recording }
+	{
+		assert(!_recording || !_baseOffset);
+		_renderer->skipFrames(_baseOffset); // TODO: Remove extra skip.
+	}
+
+	size_t currentOffset() const noexcept override
+	{
+		std::lock_guard lock{ _mutex };
+		return _renderer->currentOffset();
+	}
+
+private:
 	size_t read(void* buffer, size_t maxFrames) noexcept override
 	{
 		std::unique_lock lock{ _mutex };
-		auto renderedFrames = _renderer->render(static_cast<float*>(buffer), maxFrames);
+		const auto renderedFrames = _renderer->render(static_cast<float*>(buffer), maxFrames);
 		lock.unlock();
-		_minRemainingFrames -= std::min(_minRemainingFrames, renderedFrames);
-		if (renderedFrames < maxFrames && _minRemainingFrames > 0)
+		if (_recording && !_recordingFinished)
 		{
-			const auto paddingFrames = std::min(maxFrames - renderedFrames, _minRemainingFrames);
-			std::memset(static_cast<float*>(buffer) + renderedFrames * _format.channelCount(), 0, paddingFrames * _format.bytesPerFrame());
-			renderedFrames += paddingFrames;
-			_minRemainingFrames -= paddingFrames;
+			_recording->write(static_cast<const float*>(buffer), renderedFrames * _format.channelCount());
+			if (renderedFrames < maxFrames)
+				finishRecording(&PcmRecorder::Input::close);
 		}
-		return renderedFrames;
+		return padOutput(buffer, renderedFrames, maxFrames);
 	}
 
 	bool seek(size_t frameOffset) override
 	{
+		if (_recording && !_recordingFinished)
+			finishRecording(&PcmRecorder::Input::drop); // The recording must be contiguous.
 		_renderer->restart();
 		const auto offset = _baseOffset + frameOffset;
 		return _renderer->skipFrames(offset) == offset;
 	}
 
+	// The file is committed or discarded by the player on the main thread, since it may take a while.
+	void finishRecording(void (PcmRecorder::Input::*action)() noexcept) noexcept
+	{
+		(_recording.get()->*action)();
+		_recordingFinished = true;
+		emit _player.recordingFinished();
+	}
+
 private:
 	mutable std::mutex _mutex;
 	const std::unique_ptr<seir::synth::Renderer> _renderer;
-	const seir::synth::AudioFormat _format = _renderer->format();
 	size_t _baseOffset = 0;
-	size_t _minRemainingFrames = 0;
+	Player& _player;
+	const std::shared_ptr<PcmRecorder::Input> _recording;
+	bool _recordingFinished = false;
+};
+
+class MappedDecoder final : public AudioDecoder
+{
+public:
+	MappedDecoder(std::unique_ptr<QFile>&& file, const seir::synth::AudioFormat& format, size_t baseOffset, size_t minBufferFrames)
+		: AudioDecoder{ format, minBufferFrames }
+		, _file{ std::move(file) }
+		, _data{ reinterpret_cast<const std::byte*>(_file->map(0, _file->size())) }
+		, _totalFrames{ _data ? static_cast<size_t>(_file->size()) / _format.bytesPerFrame() : 0 }
+		, _baseOffset{ std::min(baseOffset, _totalFrames) }
+		, _offset{ _baseOffset }
+	{
+	}
+
+	size_t currentOffset() const noexcept override
+	{
+		return _offset.load();
+	}
+
+private:
+	size_t read(void* buffer, size_t maxFrames) noexcept override
+	{
+		const auto offset = _offset.load();
+		const auto frames = std::min(maxFrames, _totalFrames - offset);
+		if (frames > 0)
+			std::memcpy(buffer, _data + offset * _format.bytesPerFrame(), frames * _format.bytesPerFrame());
+		_offset.store(offset + frames);
+		return padOutput(buffer, frames, maxFrames);
+	}
+
+	bool seek(size_t frameOffset) override
+	{
+		const auto offset = _baseOffset + frameOffset;
+		_offset.store(std::min(offset, _totalFrames));
+		return offset <= _totalFrames;
+	}
+
+private:
+	const std::unique_ptr<QFile> _file;
+	const std::byte* const _data;
+	const size_t _totalFrames;
+	const size_t _baseOffset;
+	std::atomic<size_t> _offset;
 };
 
 Player::Player(QObject* parent)
@@ -89,6 +185,10 @@ Player::Player(QObject* parent)
 			emit stateChanged();
 		}
 	});
+	connect(this, &Player::recordingFinished, this, [this] {
+		if (_recorder && !_recorder->isRecording()) // The signal may come from a previous playback.
+			finishRecording();
+	}, Qt::QueuedConnection);
 	connect(&_timer, &QTimer::timeout, this, [this] {
 		emit offsetChanged(static_cast<double>(_decoder->currentOffset()));
 	});
@@ -96,10 +196,19 @@ Player::Player(QObject* parent)
 
 Player::~Player() = default;
 
-void Player::start(std::unique_ptr<seir::synth::Renderer>&& renderer, size_t baseOffset, size_t minBufferFrames)
+void Player::start(std::unique_ptr<seir::synth::Renderer>&& renderer, size_t baseOffset, size_t minBufferFrames, std::unique_ptr<PcmRecorder>&& recorder)
 {
 	stop();
-	_decoder = seir::makeShared<AudioDecoder>(std::move(renderer), baseOffset, minBufferFrames);
+	_recorder = std::move(recorder);
+	_decoder = seir::SharedPtr<AudioDecoder>{ seir::makeShared<RendererDecoder>(std::move(renderer), baseOffset, minBufferFrames, *this, _recorder ? _recorder->input() : nullptr) };
+	emit offsetChanged(static_cast<double>(_decoder->currentOffset()));
+	_backend->play(seir::SharedPtr<seir::AudioDecoder>{ _decoder });
+}
+
+void Player::start(std::unique_ptr<QFile>&& file, const seir::synth::AudioFormat& format, size_t baseOffset, size_t minBufferFrames)
+{
+	stop();
+	_decoder = seir::SharedPtr<AudioDecoder>{ seir::makeShared<MappedDecoder>(std::move(file), format, baseOffset, minBufferFrames) };
 	emit offsetChanged(static_cast<double>(_decoder->currentOffset()));
 	_backend->play(seir::SharedPtr<seir::AudioDecoder>{ _decoder });
 }
@@ -107,6 +216,17 @@ void Player::start(std::unique_ptr<seir::synth::Renderer>&& renderer, size_t bas
 void Player::stop()
 {
 	_backend->stopAll();
+	finishRecording();
+}
+
+void Player::finishRecording()
+{
+	if (!_recorder)
+		return;
+	const auto committed = _recorder->commit();
+	_recorder.reset();
+	if (committed)
+		emit recordingCommitted();
 }
 
 void Player::onPlaybackError(seir::AudioError error)
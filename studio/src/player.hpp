@@ -5,6 +5,7 @@
 #pragma once
 
 #include <seir_audio/player.hpp>
+#include <seir_synth/format.hpp>
 
 #include <memory>
 
@@ -15,7 +16,10 @@ namespace seir::synth
 	class Renderer;
 }
 
+class QFile;
+
 class AudioDecoder;
+class PcmRecorder;
 
 class Player final
 	: public QObject
@@ -28,16 +32,23 @@ public:
 	~Player() override;
 
 	constexpr bool isPlaying() const noexcept { return _state == State::Started; }
-	void start(std::unique_ptr<seir::synth::Renderer>&&, size_t baseOffset, size_t minBufferBytes);
+	// Plays rendered data, recording it if there is a recorder and the playback reaches the end without seeking.
+	// The recording is committed on the main thread, and recordingCommitted() is emitted if it succeeds.
+	void start(std::unique_ptr<seir::synth::Renderer>&&, size_t baseOffset, size_t minBufferBytes, std::unique_ptr<PcmRecorder>&& = {});
+	// Plays previously rendered data from a file without any synthesis.
+	void start(std::unique_ptr<QFile>&&, const seir::synth::AudioFormat&, size_t baseOffset, size_t minBufferBytes);
 	void stop();
 
 signals:
 	void offsetChanged(double currentFrame);
 	void playbackStarted();
 	void playbackStopped();
+	void recordingCommitted();
+	void recordingFinished(); // Emitted from the audio thread when the recording has been closed or dropped.
 	void stateChanged();
 
 private:
+	void finishRecording();
 	void onPlaybackError(seir::AudioError) override;
 	void onPlaybackError(std::string&& message) override;
 	void onPlaybackStarted() override;
@@ -53,5 +64,6 @@ private:
 	const seir::UniquePtr<seir::AudioPlayer> _backend;
 	QTimer _timer;
 	seir::SharedPtr<class AudioDecoder> _decoder;
+	std::unique_ptr<PcmRecorder> _recorder;
 	State _state = State::Stopped;
 };
@@ -4,7 +4,6 @@
 
 #include "sequence_scene.hpp"
 
-#include "../elusive_item.hpp"
 #include "../theme.hpp"
 #include "key_item.hpp"
 #include "pianoroll_item.hpp"
@@ -29,9 +28,6 @@ SequenceScene::SequenceScene(QObject* parent)
 	_pianorollItem->setPos(kWhiteKeyWidth, 0);
 	addItem(_pianorollItem.get());
 	connect(_pianorollItem.get(), &PianorollItem::newSoundRequested, this, &SequenceScene::insertingSound);
-	_rightBoundItem = new ElusiveItem{ _pianorollItem.get() };
-	_rightBoundItem->setHeight(_pianorollItem->boundingRect().height());
-	connect(_rightBoundItem, &ElusiveItem::elude, [this] { setPianorollLength(_pianorollItem->stepCount() + kPianorollStride); });
 }
 
 SequenceScene::~SequenceScene()
@@ -75,6 +71,14 @@ qreal SequenceScene::setSequence(const seir::synth::SequenceData& sequence, cons
 	return (rect.center().y() - viewSize.height() / 2) / heightDifference;
 }
 
+void SequenceScene::setVisibleRect(const QRectF& rect)
+{
+	// The pianoroll is extended by whole strides to reach a view width past the visible area,
+	// so that there is always something to scroll to, and scrolling extends it once per view width.
+	if (const auto requiredSteps = static_cast<size_t>(std::ceil(std::max(rect.right() + rect.width() - kWhiteKeyWidth, qreal{ 0 }) / kNoteWidth)); requiredSteps > _pianorollItem->stepCount())
+		setPianorollLength((requiredSteps + kPianorollStride - 1) / kPianorollStride * kPianorollStride);
+}
+
 void SequenceScene::setSoundSustain(size_t offset, seir::synth::Note note, size_t sustain)
 {
 	const auto range = _soundItems.equal_range(offset);
@@ -105,5 +109,4 @@ void SequenceScene::setPianorollLength(size_t steps)
 {
 	setSceneRect({ 0, 0, kWhiteKeyWidth + steps * kNoteWidth, _pianorollItem->boundingRect().height() });
 	_pianorollItem->setStepCount(steps);
-	_rightBoundItem->setPos(_pianorollItem->boundingRect().topRight());
 }
@@ -10,7 +10,6 @@
 
 #include <QGraphicsScene>
 
-class ElusiveItem;
 class PianorollItem;
 class SoundItem;
 
@@ -26,6 +25,7 @@ public:
 	void removeSound(size_t offset, seir::synth::Note);
 	qreal setSequence(const seir::synth::SequenceData&, const QSize& viewSize);
 	void setSoundSustain(size_t offset, seir::synth::Note, size_t sustain);
+	void setVisibleRect(const QRectF&);
 
 signals:
 	void decreasingSustain(size_t offset, seir::synth::Note);
@@ -41,6 +41,5 @@ private:
 
 private:
 	std::unique_ptr<PianorollItem> _pianorollItem;
-	ElusiveItem* _rightBoundItem = nullptr;
 	std::multimap<size_t, std::unique_ptr<SoundItem>> _soundItems;
 };
@@ -23,6 +23,8 @@ SequenceWidget::SequenceWidget(QWidget* parent)
 	_view = new QGraphicsView{ _scene, this };
 	_view->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
 	layout->addWidget(_view, 0, 0);
+	connect(_view->horizontalScrollBar(), &QScrollBar::valueChanged, this, &SequenceWidget::updateVisibleRect);
+	connect(_view->horizontalScrollBar(), &QScrollBar::rangeChanged, this, &SequenceWidget::updateVisibleRect);
 
 	connect(_scene, &SequenceScene::decreasingSustain, [this](size_t offset, seir::synth::Note note) {
 		if (!_sequenceData)
@@ -119,4 +121,16 @@ void SequenceWidget::setSequence(const std::shared_ptr<seir::synth::SequenceData
 	horizontalScrollBar->setValue(horizontalScrollBar->minimum());
 	const auto verticalScrollBar = _view->verticalScrollBar();
 	verticalScrollBar->setValue(verticalScrollBar->minimum() + std::lround((verticalScrollBar->maximum() - verticalScrollBar->minimum()) * verticalPosition));
+	updateVisibleRect();
+}
+
+void SequenceWidget::resizeEvent(QResizeEvent* e)
+{
+	QWidget::resizeEvent(e);
+	updateVisibleRect(); // The scroll bars don't change if the scene fits into the view.
+}
+
+void SequenceWidget::updateVisibleRect()
+{
+	_scene->setVisibleRect(_view->mapToScene(_view->viewport()->rect()).boundingRect());
 }
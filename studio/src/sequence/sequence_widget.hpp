@@ -32,6 +32,10 @@ signals:
 	void noteActivated(seir::synth::Note);
 	void sequenceChanged();
 
+private:
+	void resizeEvent(QResizeEvent*) override;
+	void updateVisibleRect();
+
 private:
 	SequenceScene* const _scene;
 	QGraphicsView* _view = nullptr;
@@ -5,69 +5,109 @@
 #include "studio.hpp"
 
 #include "composition/composition_widget.hpp"
+#include "library/library_widget.hpp"
 #include "sequence/sequence_widget.hpp"
+#include "autosaver.hpp"
+#include "device_sink.hpp"
+#include "exporter.hpp"
 #include "info_editor.hpp"
+#include "loader.hpp"
+#include "pcm_cache.hpp"
 #include "player.hpp"
 #include "theme.hpp"
 #include "voice_widget.hpp"
 
+#include <aulos_core/binary.hpp>
+#include <aulos_core/composition.hpp>
+#include <aulos_core/pipelined_writer.hpp>
+
 #include <seir_synth/composition.hpp>
 #include <seir_synth/renderer.hpp>
 
+#include <atomic>
 #include <cassert>
-#include <stdexcept>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <utility>
 
 #include <QApplication>
 #include <QCheckBox>
 #include <QCloseEvent>
 #include <QComboBox>
+#include <QDir>
+#include <QDockWidget>
+#include <QEventLoop>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QLockFile>
+#include <QLoggingCategory>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QProgressBar>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QSaveFile>
 #include <QSettings>
+#include <QSignalBlocker>
 #include <QSpinBox>
 #include <QSplitter>
+#include <QStandardPaths>
 #include <QStatusBar>
 #include <QStyle>
 #include <QTimer>
 #include <QToolBar>
+#include <QToolButton>
+
+Q_LOGGING_CATEGORY(studioTimings, "aulos.studio.timings", QtWarningMsg) // Enabled with QT_LOGGING_RULES="aulos.studio.timings.debug=true".
 
 namespace
 {
-	constexpr size_t kBufferSize = 8192;
 	constexpr int kMaxRecentFiles = 10;
 	const auto kRecentFileKeyBase = QStringLiteral("RecentFile%1");
-
-	std::unique_ptr<seir::synth::Composition> packComposition(seir::synth::CompositionData& data)
+	const auto kExportBlockSizeKey = QStringLiteral("ExportBlockSize");
+	const auto kAutosaveIntervalKey = QStringLiteral("AutosaveInterval");
+	const auto kRecoveryFileName = QStringLiteral("recovery-%1.aulosb");
+	const auto kRecoveryPathKey = QStringLiteral("RecoveryPath/%1");
+	const auto kShowWaveformsKey = QStringLiteral("ShowWaveforms");
+	const auto kShowMinimapKey = QStringLiteral("ShowMinimap");
+
+	constexpr int kDefaultAutosaveInterval = 60; // Seconds.
+	constexpr int kMaxRecoveryFiles = 256;        // Failing to lock this many means that the directory isn't writable.
+	constexpr std::chrono::milliseconds kReloadDelay{ 200 };
+
+	// Every running instance has its own recovery file which stays locked until the instance exits.
+	// Files left by instances which didn't exit properly are taken over first, so that they can be recovered.
+	// Returns null if no recovery file can be locked, e.g. if the data directory isn't writable.
+	std::unique_ptr<QLockFile> lockRecoveryFile(QString& path)
 	{
-		const auto maxAmplitude = [](const seir::synth::Composition& composition) {
-			// TODO: Implement gain calculation with looping.
-			const auto renderer = seir::synth::Renderer::create(composition, { seir::synth::Renderer::kMaxSamplingRate, seir::synth::ChannelLayout::Mono }, false);
-			assert(renderer);
-			float minimum = 0.f;
-			float maximum = 0.f;
-			for (std::array<float, kBufferSize / sizeof(float)> buffer;;)
+		const QDir directory{ QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) };
+		directory.mkpath(QStringLiteral("."));
+		const auto tryLock = [&directory](const QString& fileName) {
+			auto lock = std::make_unique<QLockFile>(directory.filePath(fileName + QStringLiteral(".lock")));
+			lock->setStaleLockTime(0); // Otherwise the locks of long-running instances would become stale.
+			return lock->tryLock(0) ? std::move(lock) : nullptr;
+		};
+		for (const auto& fileName : directory.entryList({ kRecoveryFileName.arg(QLatin1Char{ '*' }) }, QDir::Files))
+			if (auto lock = tryLock(fileName))
 			{
-				const auto framesRendered = renderer->render(buffer.data(), buffer.size());
-				if (!framesRendered)
-					break;
-				const auto minmax = std::minmax_element(buffer.cbegin(), buffer.cbegin() + framesRendered);
-				minimum = std::min(minimum, *minmax.first);
-				maximum = std::max(maximum, *minmax.second);
+				path = directory.filePath(fileName);
+				return lock;
 			}
-			return std::max(-minimum, maximum);
-		};
+		for (int index = 0; index < kMaxRecoveryFiles; ++index)
+			if (const auto fileName = kRecoveryFileName.arg(index); auto lock = tryLock(fileName))
+			{
+				path = directory.filePath(fileName);
+				return lock;
+			}
+		return {};
+	}
 
-		data._gainDivisor = 1;
-		auto composition = data.pack();
-		if (!composition)
-			return {};
-		data._gainDivisor = maxAmplitude(*composition);
-		return data.pack();
+	QString recoveryPathKey(const std::filesystem::path& recoveryPath)
+	{
+		return kRecoveryPathKey.arg(QString::fromStdU16String(recoveryPath.stem().u16string()));
 	}
 
 	QStringList loadRecentFileList()
@@ -122,17 +162,14 @@ namespace
 			++index;
 		}
 	}
-
-	template <typename T>
-	void writeValue(QIODevice& device, T value)
-	{
-		device.write(reinterpret_cast<const char*>(&value), sizeof value);
-	}
 }
 
 Studio::Studio()
 	: _infoEditor{ std::make_unique<InfoEditor>(this) }
 	, _player{ std::make_unique<Player>() }
+	, _pcmCache{ std::make_unique<PcmCache>() }
+	, _recoveryLock{ ::lockRecoveryFile(_recoveryPath) }
+	, _autosaver{ _recoveryLock ? std::make_unique<Autosaver>(std::filesystem::path{ _recoveryPath.toStdU16String() }) : nullptr }
 {
 	resize(1280, 720);
 
@@ -143,22 +180,18 @@ Studio::Studio()
 				return;
 			closeComposition();
 			createEmptyComposition();
-			_changed = true;
-			updateStatus();
+			markChanged();
 		},
 		Qt::CTRL | Qt::Key_N);
 	_fileOpenAction = fileMenu->addAction(
 		qApp->style()->standardIcon(QStyle::SP_DialogOpenButton), tr("&Open..."), [this] {
 			if (!maybeSaveComposition())
 				return;
-			const auto path = QFileDialog::getOpenFileName(this, tr("Open Composition"), !_compositionPath.isEmpty() ? QFileInfo{ _compositionPath }.dir().path() : QString{}, tr("Aulos Files (*.aulos)"));
+			const auto path = QFileDialog::getOpenFileName(this, tr("Open Composition"), !_compositionPath.isEmpty() ? QFileInfo{ _compositionPath }.dir().path() : QString{}, tr("Aulos Files (*.aulos *.aulosb)"));
 			if (path.isNull())
 				return;
 			closeComposition();
-			if (!openComposition(path))
-				return;
-			_changed = false;
-			updateStatus();
+			openComposition(path);
 		},
 		Qt::CTRL | Qt::Key_O);
 	_fileSaveAction = fileMenu->addAction(
@@ -206,22 +239,60 @@ Studio::Studio()
 			return;
 		_composition->_author = _infoEditor->compositionAuthor().toStdString();
 		_composition->_title = _infoEditor->compositionTitle().toStdString();
-		_changed = true;
-		updateStatus();
+		markChanged();
 	});
 
 	const auto playbackMenu = menuBar()->addMenu(tr("&Playback"));
 	_playAction = playbackMenu->addAction(qApp->style()->standardIcon(QStyle::SP_MediaPlay), tr("&Play"), [this] {
-		const auto composition = ::packComposition(*_composition);
-		if (!composition)
-			return;
 		assert(_mode == Mode::Editing);
-		_autoRepeatButton->setChecked(false);
 		const auto format = selectedFormat();
-		auto renderer = seir::synth::Renderer::create(*composition, format, _loopPlaybackCheck->isChecked());
+		const auto baseOffset = _compositionWidget->startOffset() * format.samplingRate() / _composition->_speed;
+		const auto looping = _loopPlaybackCheck->isChecked();
+		std::unique_ptr<seir::synth::Composition> composition;
+		std::unique_ptr<PcmRecorder> recorder;
+		if (looping)
+		{
+			composition = _gainCache.pack(*_composition);
+			if (!composition)
+				return;
+		}
+		else
+		{
+			// Non-looping playback output is fully determined by the composition packed with unit gain,
+			// so it can be replayed from the cache without measuring the gain again.
+			const auto gainDivisor = std::exchange(_composition->_gainDivisor, 1.f);
+			const auto unitGainComposition = _composition->pack();
+			_composition->_gainDivisor = gainDivisor;
+			if (!unitGainComposition)
+				return;
+			const auto key = aulos::renderKey(*unitGainComposition, format);
+			if (auto cachedData = _pcmCache->find(key))
+			{
+				_autoRepeatButton->setChecked(false);
+				_player->stop();
+				_mode = Mode::Playing;
+				_player->start(std::move(cachedData), format, baseOffset, 0);
+				updateStatus();
+				return;
+			}
+			auto amplitude = _gainCache.find(*unitGainComposition);
+			if (!amplitude)
+			{
+				amplitude = aulos::measureAmplitude(*unitGainComposition);
+				_gainCache.store(*unitGainComposition, *amplitude);
+			}
+			composition = aulos::normalizeComposition(*unitGainComposition, *amplitude);
+			if (!baseOffset)
+			{
+				_pcmCache->trim();
+				recorder = _pcmCache->record(key);
+			}
+		}
+		_autoRepeatButton->setChecked(false);
+		auto renderer = seir::synth::Renderer::create(*composition, format, looping);
 		_player->stop();
 		_mode = Mode::Playing;
-		_player->start(std::move(renderer), _compositionWidget->startOffset() * format.samplingRate() / _composition->_speed, 0);
+		_player->start(std::move(renderer), baseOffset, 0, std::move(recorder));
 		updateStatus();
 	});
 	_stopAction = playbackMenu->addAction(qApp->style()->standardIcon(QStyle::SP_MediaStop), tr("&Stop"), [this] {
@@ -274,12 +345,12 @@ Studio::Studio()
 	_voiceWidget->setSizePolicy(::makeExpandingSizePolicy(0, 0));
 	rootLayout->addWidget(_voiceWidget);
 	connect(_voiceWidget, &VoiceWidget::trackPropertiesChanged, [this] {
-		_changed = true;
-		updateStatus();
+		markChanged();
+		_compositionWidget->updateWaveforms();
 	});
 	connect(_voiceWidget, &VoiceWidget::voiceChanged, [this] {
-		_changed = true;
-		updateStatus();
+		markChanged();
+		_compositionWidget->updateWaveforms();
 	});
 
 	const auto splitter = new QSplitter{ Qt::Vertical, this };
@@ -317,18 +388,41 @@ Studio::Studio()
 	_statusPath->setTextFormat(Qt::RichText);
 	statusBar()->addWidget(_statusPath);
 
+	_exportStatus = new QLabel{ statusBar() };
+	_exportStatus->setVisible(false);
+	statusBar()->addPermanentWidget(_exportStatus);
+
+	_exportProgress = new QProgressBar{ statusBar() };
+	_exportProgress->setMaximumWidth(200);
+	_exportProgress->setTextVisible(false);
+	_exportProgress->setVisible(false);
+	statusBar()->addPermanentWidget(_exportProgress);
+
+	_exportCancelButton = new QToolButton{ statusBar() };
+	_exportCancelButton->setAutoRaise(true);
+	_exportCancelButton->setIcon(qApp->style()->standardIcon(QStyle::SP_DialogCancelButton));
+	_exportCancelButton->setToolTip(tr("Cancel export"));
+	_exportCancelButton->setVisible(false);
+	statusBar()->addPermanentWidget(_exportCancelButton);
+	connect(_exportCancelButton, &QToolButton::clicked, [this] {
+		if (_exporter)
+			_exporter->cancel();
+	});
+
 	connect(_speedSpin, QOverload<int>::of(&QSpinBox::valueChanged), [this] {
 		if (!_hasComposition)
 			return;
 		_composition->_speed = static_cast<unsigned>(_speedSpin->value());
 		_compositionWidget->setSpeed(_composition->_speed);
-		_changed = true;
-		updateStatus();
+		markChanged();
 	});
 	connect(_player.get(), &Player::offsetChanged, [this](double currentFrame) {
 		if (_mode == Mode::Playing)
 			_compositionWidget->setPlaybackOffset(currentFrame * _composition->_speed / _samplingRateCombo->currentData().toDouble());
 	});
+	connect(_player.get(), &Player::recordingCommitted, [this] {
+		_pcmCache->trim(); // The new file wasn't counted when the cache was trimmed before recording.
+	});
 	connect(_player.get(), &Player::stateChanged, [this] {
 		if (_mode == Mode::Editing)
 		{
@@ -353,8 +447,7 @@ Studio::Studio()
 	});
 	connect(_compositionWidget, &CompositionWidget::compositionChanged, [this] {
 		_autoRepeatButton->setChecked(false);
-		_changed = true;
-		updateStatus();
+		markChanged();
 	});
 	connect(_sequenceWidget, &SequenceWidget::noteActivated, [this](seir::synth::Note note) {
 		bool play = true;
@@ -369,15 +462,79 @@ Studio::Studio()
 	connect(_sequenceWidget, &SequenceWidget::sequenceChanged, [this] {
 		_compositionWidget->updateSelectedSequence(_sequenceWidget->sequence());
 		_autoRepeatButton->setChecked(false);
-		_changed = true;
-		updateStatus();
+		markChanged();
+	});
+
+	const auto libraryDock = new QDockWidget{ tr("Library"), this };
+	libraryDock->setObjectName(QStringLiteral("LibraryDock"));
+	const auto libraryWidget = new LibraryWidget{ libraryDock };
+	libraryDock->setWidget(libraryWidget);
+	addDockWidget(Qt::LeftDockWidgetArea, libraryDock);
+	const auto viewMenu = menuBar()->addMenu(tr("&View"));
+	viewMenu->addAction(libraryDock->toggleViewAction());
+	viewMenu->addSeparator();
+	viewMenu->addAction(
+		tr("Zoom &In"), [this] { _compositionWidget->zoomIn(); }, Qt::CTRL | Qt::Key_Plus);
+	viewMenu->addAction(
+		tr("Zoom &Out"), [this] { _compositionWidget->zoomOut(); }, Qt::CTRL | Qt::Key_Minus);
+	viewMenu->addAction(
+		tr("&Reset Zoom"), [this] { _compositionWidget->resetZoom(); }, Qt::CTRL | Qt::Key_0);
+	viewMenu->addSeparator();
+	const auto waveformsAction = viewMenu->addAction(tr("Track &Waveforms"));
+	waveformsAction->setCheckable(true);
+	connect(waveformsAction, &QAction::toggled, [this](bool checked) {
+		_compositionWidget->setWaveformsVisible(checked);
+		QSettings{}.setValue(kShowWaveformsKey, checked);
+	});
+	waveformsAction->setChecked(QSettings{}.value(kShowWaveformsKey, false).toBool());
+	const auto minimapAction = viewMenu->addAction(tr("&Minimap"));
+	minimapAction->setCheckable(true);
+	connect(minimapAction, &QAction::toggled, [this](bool checked) {
+		_compositionWidget->setMinimapVisible(checked);
+		QSettings{}.setValue(kShowMinimapKey, checked);
+	});
+	minimapAction->setChecked(QSettings{}.value(kShowMinimapKey, false).toBool());
+	connect(libraryWidget, &LibraryWidget::openRequested, [this](const QString& path) {
+		if (_loader || !maybeSaveComposition())
+			return;
+		closeComposition();
+		openComposition(path);
 	});
 
+	// Scripts may write a file in several steps, so reloading is delayed until the changes settle.
+	_fileWatcher = new QFileSystemWatcher{ this };
+	_reloadTimer = new QTimer{ this };
+	_reloadTimer->setSingleShot(true);
+	_reloadTimer->setInterval(kReloadDelay);
+	connect(_fileWatcher, &QFileSystemWatcher::fileChanged, _reloadTimer, QOverload<>::of(&QTimer::start));
+	connect(_reloadTimer, &QTimer::timeout, this, &Studio::reloadComposition);
+
+	if (const auto interval = QSettings{}.value(kAutosaveIntervalKey, kDefaultAutosaveInterval).toInt(); _autosaver && interval > 0)
+	{
+		const auto autosaveTimer = new QTimer{ this };
+		connect(autosaveTimer, &QTimer::timeout, this, &Studio::autosave);
+		autosaveTimer->start(interval * 1000);
+	}
+
 	updateStatus();
+	QTimer::singleShot(0, this, &Studio::offerRecovery);
 }
 
 Studio::~Studio() = default;
 
+void Studio::autosave()
+{
+	if (!_autosaver || !_hasComposition || !_changed || _autosaved || _loader)
+		return;
+	// The snapshot is the only work done on the UI thread, it's serialized and written in the background.
+	const auto start = std::chrono::steady_clock::now();
+	_autosaver->save(aulos::copyCompositionData(*_composition));
+	const std::chrono::nanoseconds snapshotTime = std::chrono::steady_clock::now() - start;
+	QSettings{}.setValue(::recoveryPathKey(_autosaver->path()), _compositionPath);
+	_autosaved = true;
+	qCDebug(studioTimings).noquote() << tr("Autosaved %1 (snapshot %2 ms)").arg(_compositionFileName, QString::number(std::chrono::duration<double, std::milli>{ snapshotTime }.count(), 'f', 3));
+}
+
 void Studio::clearRecentFiles()
 {
 	for (const auto action : _recentFilesActions)
@@ -394,11 +551,15 @@ void Studio::closeComposition()
 	_hasComposition = false;
 	_compositionPath.clear();
 	_compositionFileName.clear();
+	_reloader.reset();
+	watchCompositionFile();
 	_speedSpin->setValue(_speedSpin->minimum());
 	_loopPlaybackCheck->setChecked(false);
 	_compositionWidget->setComposition({});
 	_player->stop();
 	_mode = Mode::Editing;
+	if (_autosaver)
+		_autosaver->discard();
 }
 
 void Studio::createEmptyComposition()
@@ -418,61 +579,60 @@ void Studio::createEmptyComposition()
 
 void Studio::exportComposition()
 {
-	const auto composition = ::packComposition(*_composition);
-	if (!composition)
-		return;
-
+	assert(!_exporter);
 	const auto path = QFileDialog::getSaveFileName(this, tr("Export Composition"), {}, tr("WAV Files (*.wav)"));
 	if (path.isNull())
 		return;
 
-	QSaveFile file{ path };
-	if (!file.open(QIODevice::WriteOnly))
+	// The packed composition is an immutable snapshot, so editing may continue while it's being exported.
+	const auto gainDivisor = std::exchange(_composition->_gainDivisor, 1.f);
+	auto composition = _composition->pack();
+	_composition->_gainDivisor = gainDivisor;
+	if (!composition)
 		return;
 
-	const auto format = selectedFormat();
-	const auto renderer = seir::synth::Renderer::create(*composition, format, false);
-	assert(renderer);
-
-	constexpr size_t chunkHeaderSize = 8;
-	constexpr size_t fmtChunkSize = 16;
-	constexpr auto totalHeadersSize = chunkHeaderSize + 4 + chunkHeaderSize + fmtChunkSize + chunkHeaderSize;
-
-	file.write("RIFF");
-	const auto riffSizePos = file.pos();
-	::writeValue<uint32_t>(file, static_cast<uint32_t>(totalHeadersSize));
-	assert(file.pos() == chunkHeaderSize);
-	file.write("WAVE");
-	file.write("fmt ");
-	::writeValue<uint32_t>(file, fmtChunkSize);
-	::writeValue<uint16_t>(file, 3); // Data format: IEEE float PCM samples.
-	::writeValue<uint16_t>(file, format.channelCount());
-	::writeValue<uint32_t>(file, format.samplingRate());
-	::writeValue<uint32_t>(file, format.samplingRate() * format.bytesPerFrame());
-	::writeValue<uint16_t>(file, format.bytesPerFrame());
-	::writeValue<uint16_t>(file, sizeof(float) * 8);
-	file.write("data");
-	const auto dataSizePos = file.pos();
-	::writeValue<uint32_t>(file, 0);
-	assert(file.pos() == totalHeadersSize);
-
-	size_t dataSize = 0;
-	for (std::array<char, kBufferSize> buffer;;)
-	{
-		auto renderedBytes = renderer->render(reinterpret_cast<float*>(buffer.data()), buffer.size() / format.bytesPerFrame()) * format.bytesPerFrame();
-		if (!renderedBytes)
-			break;
-		file.write(buffer.data(), static_cast<qint64>(renderedBytes));
-		dataSize += renderedBytes;
-	}
-
-	file.seek(riffSizePos);
-	::writeValue<uint32_t>(file, static_cast<uint32_t>(totalHeadersSize + dataSize));
-
-	file.seek(dataSizePos);
-	::writeValue<uint32_t>(file, static_cast<uint32_t>(dataSize));
+	const auto blockSize = QSettings{}.value(kExportBlockSizeKey, qulonglong{ aulos::PipelinedWriter::kDefaultBlockSize }).toULongLong();
+	_exporter = std::make_unique<Exporter>(std::move(composition), selectedFormat(), path, static_cast<size_t>(blockSize));
+	connect(_exporter.get(), &Exporter::progressChanged, this, [this](double renderedFrames, double totalFrames) {
+		if (!_exporter)
+			return;
+		if (totalFrames > 0)
+		{
+			_exportStatus->setText(tr("Exporting: %L1 of %L2 frames").arg(renderedFrames, 0, 'f', 0).arg(totalFrames, 0, 'f', 0));
+			_exportProgress->setRange(0, 1000);
+			_exportProgress->setValue(static_cast<int>(renderedFrames * 1000 / totalFrames));
+		}
+		else
+			_exportStatus->setText(tr("Measuring gain: %L1 frames").arg(renderedFrames, 0, 'f', 0));
+	});
+	connect(_exporter.get(), &Exporter::finished, this, [this](bool success, const QString& errorString) {
+		if (!_exporter)
+			return;
+		const auto fileName = QFileInfo{ _exporter->path() }.fileName();
+		_exporter.reset();
+		_exportStatus->setVisible(false);
+		_exportProgress->setVisible(false);
+		_exportCancelButton->setVisible(false);
+		if (success)
+			statusBar()->showMessage(tr("Exported %1").arg(fileName), 5000);
+		else if (!errorString.isEmpty())
+			QMessageBox::critical(this, {}, errorString);
+		updateStatus();
+	});
+	_exportStatus->setText(tr("Measuring gain..."));
+	_exportStatus->setVisible(true);
+	_exportProgress->setRange(0, 0);
+	_exportProgress->setVisible(true);
+	_exportCancelButton->setVisible(true);
+	_exporter->start();
+	updateStatus();
+}
 
-	file.commit();
+void Studio::markChanged()
+{
+	_changed = true;
+	_autosaved = false;
+	updateStatus();
 }
 
 bool Studio::maybeSaveComposition()
@@ -483,33 +643,82 @@ bool Studio::maybeSaveComposition()
 	return action == QMessageBox::Yes ? (_compositionPath.isEmpty() ? saveCompositionAs() : saveComposition(_compositionPath)) : action == QMessageBox::No;
 }
 
-bool Studio::openComposition(const QString& path)
+void Studio::offerRecovery()
 {
-	assert(!_hasComposition);
-
-	QFile file{ path };
-	if (!file.open(QIODevice::ReadOnly))
-		return false;
-
-	std::unique_ptr<seir::synth::Composition> composition;
-	try
+	if (!_autosaver)
 	{
-		composition = seir::synth::Composition::create(file.readAll().constData());
+		QMessageBox::warning(this, {}, tr("Unable to create a recovery file in %1. Unsaved changes won't be autosaved.").arg(QDir::toNativeSeparators(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation))));
+		return;
 	}
-	catch (const std::runtime_error&)
+	// The recovery file exists at startup only if it was left by an instance which didn't exit properly.
+	const auto recoveryPath = QString::fromStdU16String(_autosaver->path().u16string());
+	if (_hasComposition || _loader || !QFileInfo::exists(recoveryPath))
+		return;
+	const auto originalPath = QSettings{}.value(::recoveryPathKey(_autosaver->path())).toString();
+	const auto question = originalPath.isEmpty()
+		? tr("Aulos Studio was not closed properly. Recover the unsaved composition?")
+		: tr("Aulos Studio was not closed properly. Recover unsaved changes to %1?").arg(originalPath);
+	if (QMessageBox::question(this, {}, question, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) != QMessageBox::Yes)
 	{
-		return false;
+		_autosaver->discard();
+		return;
 	}
+	openComposition(recoveryPath, originalPath);
+}
 
-	_composition = std::make_shared<seir::synth::CompositionData>(*composition);
-	_compositionPath = path;
-	_compositionFileName = QFileInfo{ file }.fileName();
-	_speedSpin->setValue(static_cast<int>(_composition->_speed));
-	_compositionWidget->setComposition(_composition);
-	_hasComposition = true;
-	setRecentFile(path);
-	saveRecentFiles();
-	return true;
+void Studio::openComposition(const QString& path, const std::optional<QString>& recoveredPath)
+{
+	assert(!_hasComposition);
+	assert(!_loader);
+
+	// The file is loaded on a background thread, and the scene creates items only for the visible area,
+	// so the Studio doesn't freeze on big compositions.
+	_loader = std::make_unique<Loader>(path);
+	connect(_loader.get(), &Loader::finished, this, [this, recoveredPath](bool success, const QString& errorString) {
+		if (!_loader)
+			return;
+		const auto loader = std::move(_loader);
+		if (!success)
+		{
+			statusBar()->clearMessage();
+			QMessageBox::critical(this, {}, tr("Unable to open %1: %2").arg(QFileInfo{ loader->path() }.fileName(), errorString));
+			updateStatus();
+			return;
+		}
+
+		const auto sceneStart = std::chrono::steady_clock::now();
+		_composition = loader->composition();
+		_compositionPath = recoveredPath.value_or(loader->path());
+		_compositionFileName = _compositionPath.isEmpty() ? tr("Recovered composition") : QFileInfo{ _compositionPath }.fileName();
+		_speedSpin->setValue(static_cast<int>(_composition->_speed));
+		_compositionWidget->setComposition(_composition);
+		const std::chrono::nanoseconds sceneTime = std::chrono::steady_clock::now() - sceneStart;
+		_hasComposition = true;
+		if (recoveredPath)
+		{
+			// The recovery file is kept until the recovered composition is either saved or closed.
+			_changed = true;
+			_autosaved = true;
+		}
+		else
+		{
+			_changed = false;
+			setRecentFile(_compositionPath);
+			saveRecentFiles();
+		}
+		watchCompositionFile();
+		updateStatus();
+
+		const auto& timings = loader->timings();
+		const auto milliseconds = [](std::chrono::nanoseconds duration) { return QString::number(std::chrono::duration<double, std::milli>{ duration }.count(), 'f', 1); };
+		const auto message = tr("Opened %1 in %2 ms (read %3 ms, parse %4 ms, convert %5 ms, first screen %6 ms)")
+								 .arg(_compositionFileName, milliseconds(timings._read + timings._parse + timings._convert + sceneTime), milliseconds(timings._read), milliseconds(timings._parse), milliseconds(timings._convert), milliseconds(sceneTime));
+		qCDebug(studioTimings).noquote() << message;
+		statusBar()->showMessage(message, 5000);
+	});
+	statusBar()->showMessage(tr("Opening %1...").arg(QFileInfo{ path }.fileName()));
+	_loader->start();
+	updateStatus();
 }
 
 void Studio::playNote(seir::synth::Note note)
@@ -518,30 +727,129 @@ void Studio::playNote(seir::synth::Note note)
 	_player->start(seir::synth::Renderer::create(*seir::synth::CompositionData{ _voiceWidget->voice(), note }.pack(), format), 0, format.samplingRate());
 }
 
-bool Studio::saveComposition(const QString& path) const
+void Studio::reloadComposition()
+{
+	if (!_hasComposition || _compositionPath.isEmpty() || _loader)
+		return;
+	if (_reloader || _measuringGain)
+	{
+		_reloadTimer->start(); // The file has changed while it was being reloaded or saved.
+		return;
+	}
+	if (!QFileInfo::exists(_compositionPath))
+		return;
+	watchCompositionFile(); // A file replaced by renaming is no longer watched.
+	_reloader = std::make_unique<Loader>(_compositionPath);
+	connect(_reloader.get(), &Loader::finished, this, [this](bool success, const QString& errorString) {
+		if (!_reloader)
+			return;
+		const auto reloader = std::move(_reloader);
+		if (!_hasComposition || reloader->path() != _compositionPath)
+			return;
+		if (!success)
+		{
+			statusBar()->showMessage(tr("Unable to reload %1: %2").arg(_compositionFileName, errorString), 5000);
+			return;
+		}
+		if (_changed && QMessageBox::question(this, {}, tr("%1 was modified by another program. Reload it and discard your changes?").arg(_compositionFileName), QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+			return;
+
+		const auto sceneStart = std::chrono::steady_clock::now();
+		_compositionWidget->reloadComposition(reloader->composition());
+		{
+			const QSignalBlocker blocker{ _speedSpin };
+			_speedSpin->setValue(static_cast<int>(_composition->_speed));
+		}
+		const std::chrono::nanoseconds sceneTime = std::chrono::steady_clock::now() - sceneStart;
+		_changed = false;
+		if (_autosaver)
+			_autosaver->discard();
+		updateStatus();
+
+		const auto& timings = reloader->timings();
+		const auto milliseconds = [](std::chrono::nanoseconds duration) { return QString::number(std::chrono::duration<double, std::milli>{ duration }.count(), 'f', 1); };
+		const auto message = tr("Reloaded %1 in %2 ms (read %3 ms, parse %4 ms, convert %5 ms, scene update %6 ms)")
+								 .arg(_compositionFileName, milliseconds(timings._read + timings._parse + timings._convert + sceneTime), milliseconds(timings._read), milliseconds(timings._parse), milliseconds(timings._convert), milliseconds(sceneTime));
+		qCDebug(studioTimings).noquote() << message;
+		statusBar()->showMessage(message, 5000);
+	});
+	_reloader->start();
+}
+
+std::optional<float> Studio::measureGain(const seir::synth::Composition& composition)
+{
+	if (const auto amplitude = _gainCache.find(composition))
+		return amplitude;
+	if (_measuringGain)
+		return {}; // The nested event loop must not start another save.
+	// Long compositions take seconds to measure, so the measurement runs on a background thread
+	// while the window is blocked by a progress dialog and the user can cancel it.
+	// The dialog is shown at once, otherwise the window would accept input until it appears.
+	_measuringGain = true;
+	QProgressDialog progress{ tr("Measuring the gain..."), tr("Cancel"), 0, 0, this }; // The total length is unknown until the measurement is finished.
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setMinimumDuration(0);
+	progress.show();
+	std::atomic<bool> cancelled{ false };
+	connect(&progress, &QProgressDialog::canceled, [&cancelled] { cancelled = true; });
+	QEventLoop loop;
+	std::optional<float> amplitude;
+	std::thread thread{ [&] {
+		amplitude = aulos::measureAmplitude(composition, [&cancelled](size_t) { return !cancelled; });
+		QMetaObject::invokeMethod(&loop, &QEventLoop::quit, Qt::QueuedConnection);
+	} };
+	loop.exec();
+	thread.join();
+	_measuringGain = false;
+	if (amplitude)
+		_gainCache.store(composition, *amplitude);
+	return amplitude;
+}
+
+bool Studio::saveComposition(const QString& path)
 {
 	assert(_hasComposition);
 	assert(!path.isEmpty());
-	const auto composition = ::packComposition(*_composition);
+	// The gain is measured only if the composition has changed since it was last measured,
+	// and the data is written into a temporary file which replaces the target only when complete.
+	const auto gainDivisor = std::exchange(_composition->_gainDivisor, 1.f);
+	const auto unitGainComposition = _composition->pack();
+	_composition->_gainDivisor = gainDivisor;
+	assert(unitGainComposition);
+	const auto amplitude = measureGain(*unitGainComposition);
+	if (!amplitude)
+		return false;
+	_composition->_gainDivisor = *amplitude;
+	const auto composition = aulos::normalizeComposition(*unitGainComposition, *amplitude);
 	assert(composition);
-	const auto buffer = seir::synth::serialize(*composition);
-	QFile file{ path };
-	if (!file.open(QIODevice::WriteOnly) || file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(buffer.size())) < static_cast<qint64>(buffer.size()))
+	_compositionWidget->updateWaveforms(); // The gain may have changed.
+	const auto isBinary = path.endsWith(QStringLiteral(".aulosb"), Qt::CaseInsensitive);
+	if (const auto watchedFiles = _fileWatcher->files(); !watchedFiles.isEmpty())
+		_fileWatcher->removePaths(watchedFiles); // Our own changes shouldn't trigger reloading.
+	QSaveFile file{ path };
+	if (DeviceSink sink{ file }; !file.open(QIODevice::WriteOnly) || !(isBinary ? aulos::saveBinaryComposition(*_composition, sink) : aulos::saveComposition(*composition, sink)) || !file.commit())
 	{
-		QMessageBox::critical(const_cast<Studio*>(this), QString{}, file.errorString());
+		const auto errorString = file.errorString();
+		file.cancelWriting();
+		QMessageBox::critical(this, QString{}, errorString);
+		watchCompositionFile();
 		return false;
 	}
+	if (_autosaver)
+		_autosaver->discard();
+	watchCompositionFile();
 	return true;
 }
 
 bool Studio::saveCompositionAs()
 {
 	assert(_hasComposition);
-	const auto path = QFileDialog::getSaveFileName(this, tr("Save Composition As"), _compositionPath.isEmpty() ? QString{} : QFileInfo{ _compositionPath }.dir().path(), tr("Aulos Files (*.aulos)"));
+	const auto path = QFileDialog::getSaveFileName(this, tr("Save Composition As"), _compositionPath.isEmpty() ? QString{} : QFileInfo{ _compositionPath }.dir().path(), tr("Aulos Files (*.aulos);;Aulos Binary Files (*.aulosb)"));
 	if (path.isNull() || !saveComposition(path))
 		return false;
 	_compositionPath = path;
 	_compositionFileName = QFileInfo{ _compositionPath }.fileName();
+	watchCompositionFile();
 	setRecentFile(_compositionPath);
 	return true;
 }
@@ -564,8 +872,6 @@ void Studio::setRecentFile(const QString& path)
 				return;
 			closeComposition();
 			openComposition(path);
-			_changed = false;
-			updateStatus();
 		});
 		_recentFilesActions.prepend(action);
 		_recentFilesMenu->insertAction(_recentFilesMenu->actions().value(0, nullptr), action);
@@ -596,9 +902,12 @@ void Studio::updateStatus()
 	const auto applicationName = QCoreApplication::applicationName() + ' ' + QCoreApplication::applicationVersion();
 	const auto compositionName = _hasComposition && !_composition->_title.empty() ? QString::fromStdString(_composition->_title) : _compositionFileName;
 	setWindowTitle(_hasComposition ? QStringLiteral("%1 - %2").arg(_changed ? '*' + compositionName : compositionName, applicationName) : applicationName);
+	_fileNewAction->setEnabled(!_loader);
+	_fileOpenAction->setEnabled(!_loader);
+	_recentFilesMenu->setEnabled(!_loader);
 	_fileSaveAction->setEnabled(_changed);
 	_fileSaveAsAction->setEnabled(_hasComposition);
-	_fileExportAction->setEnabled(_hasComposition);
+	_fileExportAction->setEnabled(_hasComposition && !_exporter);
 	_fileCloseAction->setEnabled(_hasComposition);
 	_editInfoAction->setEnabled(_hasComposition);
 	_playAction->setEnabled(_hasComposition && _mode == Mode::Editing);
@@ -616,7 +925,39 @@ void Studio::updateStatus()
 	_statusPath->setText(_compositionPath.isEmpty() ? QStringLiteral("<i>%1</i>").arg(tr("No file")) : _compositionPath);
 }
 
+void Studio::watchCompositionFile()
+{
+	if (const auto watchedFiles = _fileWatcher->files(); !watchedFiles.isEmpty())
+		_fileWatcher->removePaths(watchedFiles);
+	if (!_compositionPath.isEmpty())
+		_fileWatcher->addPath(_compositionPath);
+}
+
 void Studio::closeEvent(QCloseEvent* e)
 {
-	e->setAccepted(maybeSaveComposition());
+	if (_measuringGain)
+	{
+		e->ignore(); // The composition is being saved already.
+		return;
+	}
+	// Unsaved changes are resolved first, so that the export isn't cancelled if the user changes their mind about exiting.
+	if (!maybeSaveComposition())
+	{
+		e->ignore();
+		return;
+	}
+	if (_exporter) // The export may have finished while the composition was being saved.
+	{
+		if (QMessageBox::question(this, {}, tr("Export is in progress. Cancel it and exit?"), QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+		{
+			e->ignore();
+			return;
+		}
+		_exporter.reset(); // Cancels the export and waits for the partially written file to be discarded.
+		_exportProgress->setVisible(false);
+		_exportCancelButton->setVisible(false);
+	}
+	if (_autosaver)
+		_autosaver->discard();
+	e->accept();
 }
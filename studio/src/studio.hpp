@@ -2,6 +2,8 @@
 // Copyright (C) Sergei Blagodarin.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <aulos_core/composition.hpp>
+
 #include <seir_synth/data.hpp>
 #include <seir_synth/format.hpp>
 
@@ -12,12 +14,21 @@
 
 class QCheckBox;
 class QComboBox;
+class QFileSystemWatcher;
 class QLabel;
+class QLockFile;
+class QProgressBar;
 class QPushButton;
 class QSpinBox;
+class QTimer;
+class QToolButton;
 
+class Autosaver;
 class CompositionWidget;
+class Exporter;
 class InfoEditor;
+class Loader;
+class PcmCache;
 class Player;
 class SequenceWidget;
 class VoiceWidget;
@@ -31,19 +42,27 @@ public:
 	~Studio() override;
 
 private:
+	void autosave();
 	void clearRecentFiles();
 	void closeComposition();
 	void createEmptyComposition();
 	void exportComposition();
+	void markChanged();
 	bool maybeSaveComposition();
-	bool openComposition(const QString& path);
+	// Returns the amplitude of the composition packed with unit gain divisor, or nothing if the measurement was cancelled.
+	std::optional<float> measureGain(const seir::synth::Composition&);
+	void offerRecovery();
+	// Opens the composition from the recovery file if the original path of the recovered composition is specified.
+	void openComposition(const QString& path, const std::optional<QString>& recoveredPath = {});
 	void playNote(seir::synth::Note);
-	bool saveComposition(const QString& path) const;
+	void reloadComposition();
+	bool saveComposition(const QString& path);
 	bool saveCompositionAs();
 	void saveRecentFiles() const;
 	seir::synth::AudioFormat selectedFormat() const;
 	void setRecentFile(const QString& path);
 	void updateStatus();
+	void watchCompositionFile();
 
 private:
 	void closeEvent(QCloseEvent*) override;
@@ -57,9 +76,17 @@ private:
 
 	std::shared_ptr<seir::synth::CompositionData> _composition;
 	std::unique_ptr<InfoEditor> _infoEditor;
+	aulos::GainCache _gainCache;
 
 	size_t _startStep = 0;
 	std::unique_ptr<Player> _player;
+	std::unique_ptr<PcmCache> _pcmCache;
+	std::unique_ptr<Exporter> _exporter;
+	std::unique_ptr<Loader> _loader;
+	std::unique_ptr<Loader> _reloader;
+	QString _recoveryPath;
+	std::unique_ptr<QLockFile> _recoveryLock; // Keeps other instances from taking over the recovery file.
+	std::unique_ptr<Autosaver> _autosaver;    // Null if no recovery file could be locked.
 
 	QString _compositionPath;
 	QString _compositionFileName;
@@ -68,6 +95,8 @@ private:
 	std::optional<seir::synth::Note> _autoRepeatNote;
 	bool _hasComposition = false;
 	bool _changed = false;
+	bool _autosaved = false;
+	bool _measuringGain = false; // Reloading is postponed while the composition is being saved.
 
 	QAction* _fileNewAction;
 	QAction* _fileOpenAction;
@@ -88,5 +117,10 @@ private:
 	VoiceWidget* _voiceWidget;
 	SequenceWidget* _sequenceWidget;
 	QPushButton* _autoRepeatButton;
+	QFileSystemWatcher* _fileWatcher;
+	QTimer* _reloadTimer;
 	QLabel* _statusPath;
+	QLabel* _exportStatus;
+	QProgressBar* _exportProgress;
+	QToolButton* _exportCancelButton;
 };
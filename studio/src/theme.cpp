@@ -44,6 +44,8 @@ const std::array<Colors, 12> kFragmentHighlightColors{
 
 const Colors kLoopItemColors{ Qt::darkCyan, Qt::transparent };
 
+const Colors kMinimapViewColors{ "#40ffffff", "#eee" };
+
 const std::array<Colors, 2> kTimelineColors{
 	Colors{ "#444", "#ddd" },
 	Colors{ "#333", "#ddd" },
@@ -61,6 +63,10 @@ const std::array<Colors, 2> kVoiceHighlightColors{
 	Colors{ "#333", "#eee" },
 };
 
+const Colors kWaveformColors{ "#a0000000", "#bbb" };
+const QColor kWaveformClipColor{ "#f33" };
+const QColor kWaveformRmsColor{ "#eee" };
+
 const std::array<TrackColors, 2> kTrackColors{
 	TrackColors{ "#777", "#666" },
 	TrackColors{ "#666", "#555" },
@@ -9,7 +9,13 @@
 #include <QColor>
 
 // Composition.
-constexpr auto kStepWidth = 15.0;
+constexpr auto kStepWidth = 15.0;                       // At the default zoom level.
+constexpr auto kMinZoomLevel = -6;                      // Zoom level N scales the step width by 2^N.
+constexpr auto kMaxZoomLevel = 1;
+constexpr auto kMinFragmentTextStepWidth = kStepWidth;  // Notes are shown as text only if they fit.
+constexpr auto kMinFragmentNoteStepWidth = 2.0;         // Otherwise fragments show note onsets, or nothing if they don't fit either.
+constexpr auto kMinTrackGridCellWidth = kStepWidth / 2; // Narrower steps are grouped into wider track grid cells.
+constexpr auto kMinTimelineLabelWidth = 3 * kStepWidth; // Narrower seconds are grouped into wider timeline intervals.
 constexpr auto kTrackHeight = 40.0;
 constexpr auto kTimelineHeight = 0.5 * kTrackHeight;
 constexpr auto kTimelineMarkingsHeight = kTimelineHeight;
@@ -25,6 +31,10 @@ constexpr auto kVoiceNameMargin = (kTrackHeight - kVoiceNameFontSize) / 2;
 constexpr auto kCompositionPageSwitchMargin = 50;
 constexpr auto kLoopItemOffset = 2.0;
 constexpr auto kLoopItemHeight = 8.0;
+constexpr auto kCursorWidth = 2.0;
+constexpr auto kWaveformLaneHeight = kTrackHeight / 4;
+constexpr auto kMinimapHeight = 64;
+constexpr auto kMaxMinimapTrackHeight = 4.0;
 constexpr auto kCompositionFooterHeight = kLoopItemOffset + kLoopItemHeight;
 
 // Pianoroll.
@@ -50,10 +60,14 @@ extern const Colors kCursorColors;
 extern const std::array<Colors, 12> kFragmentColors;
 extern const std::array<Colors, 12> kFragmentHighlightColors;
 extern const Colors kLoopItemColors;
+extern const Colors kMinimapViewColors;
 extern const std::array<Colors, 2> kTimelineColors;
 extern const Colors kTimelineOffsetMarkColors;
 extern const std::array<Colors, 2> kVoiceColors;
 extern const std::array<Colors, 2> kVoiceHighlightColors;
+extern const Colors kWaveformColors;
+extern const QColor kWaveformClipColor;
+extern const QColor kWaveformRmsColor;
 
 struct TrackColors
 {